@@ -26,14 +26,94 @@ typedef struct hashwx_ctx hashwx_ctx;
 
 /* Type of hash function */
 typedef enum hashwx_type {
-    HASHWX_INTERPRETED,
-    HASHWX_COMPILED
+    HASHWX_INTERPRETED = 0,
+    HASHWX_COMPILED = 1,
+    /*
+     * Optional flag for HASHWX_COMPILED. The generated code is written and
+     * executed through two different mappings of the same memory, so
+     * hashwx_make doesn't need to change page permissions. If the platform
+     * doesn't support it, the flag is ignored.
+     */
+    HASHWX_DUAL_MAPPED = 2,
+    /*
+     * Tiered execution. hashwx_make only generates the function, which is
+     * interpreted until more than HASHWX_JIT_THRESHOLD nonces have been
+     * hashed (see hashwx_set_jit_threshold). Then it is compiled. Can be
+     * combined with HASHWX_DUAL_MAPPED. Without a compiler, this is the
+     * same as HASHWX_INTERPRETED. An instance of this type must not be
+     * used by multiple threads at the same time.
+     */
+    HASHWX_AUTO = 4
 } hashwx_type;
 
+/* Opaque struct representing a client puzzle solver */
+typedef struct hashwx_puzzle hashwx_puzzle;
+
+/* Opaque struct representing a multi-threaded client puzzle solver */
+typedef struct hashwx_solver hashwx_solver;
+
+/*
+ * Progress callback of hashwx_solver_run. The hashes parameter is the total
+ * number of nonces tried so far. Return a non-zero value to cancel the run.
+ */
+typedef int hashwx_progress_func(void* user_data, uint64_t hashes);
+
+/* Opaque struct representing a multi-threaded batch verifier */
+typedef struct hashwx_verifier hashwx_verifier;
+
+/* Opaque struct representing a thread-safe cache of HashWX functions */
+typedef struct hashwx_cache hashwx_cache;
+
+/* Opaque struct representing a read-only file of exported HashWX functions */
+typedef struct hashwx_pack hashwx_pack;
+
 /* Sentinel value used to indicate unsupported type */
 #define HASHWX_NOTSUPP ((hashwx_ctx*)-1)
 /* Size of the seed for hashwx_make */
 #define HASHWX_SEED_SIZE 32
+/* Size of the client puzzle challenge */
+#define HASHWX_CHALLENGE_SIZE 32
+/* Recommended number of client puzzle attempts per function */
+#define HASHWX_PUZZLE_ATTEMPTS 463
+/* Size of an exported HashWX function */
+#define HASHWX_EXPORT_SIZE 1044
+/* Default number of nonces interpreted by HASHWX_AUTO instances */
+#define HASHWX_JIT_THRESHOLD 1
+
+/* Solution to be checked by hashwx_verify_many */
+typedef struct hashwx_proof {
+    uint8_t seed[HASHWX_SEED_SIZE];
+    uint64_t nonce;
+    uint64_t target;
+} hashwx_proof;
+
+/* Counters reported by hashwx_cache_get_stats */
+typedef struct hashwx_cache_stats {
+    uint64_t hits;      /* calls that found a ready function */
+    uint64_t misses;    /* calls that had to make the function */
+    uint64_t evictions; /* functions removed to make room for a new seed */
+    size_t entries;     /* number of functions currently cached */
+    size_t capacity;    /* maximum number of cached functions */
+} hashwx_cache_stats;
+
+/* Number of possible branch loop iterations per phase, plus 1 */
+#define HASHWX_BRANCH_BUCKETS 33
+
+/* Counters reported by hashwx_get_stats and hashwx_get_global_stats */
+typedef struct hashwx_stats {
+    uint64_t makes;       /* hashwx_make and hashwx_import_program calls */
+    uint64_t hashes;      /* nonces hashed */
+    uint64_t generate_ns; /* time spent generating interpreted functions */
+    uint64_t compile_ns;  /* time spent compiling, including the generation of compiled functions */
+    uint64_t exec_ns;     /* time spent hashing */
+    /* nonces hashed by the scalar interpreter by the number of branch loop
+       iterations taken in the register and memory phase. Nonces hashed by
+       compiled code or by the SIMD interpreters of hashwx_exec_batch,
+       hashwx_exec_array and hashwx_search are not included, so the sum of
+       each histogram can be less than hashes. */
+    uint64_t reg_branches[HASHWX_BRANCH_BUCKETS];
+    uint64_t mem_branches[HASHWX_BRANCH_BUCKETS];
+} hashwx_stats;
 
 #if defined(_WIN32) || defined(__CYGWIN__)
 #define HASHWX_WIN
@@ -75,6 +155,35 @@ extern "C" {
 */
 HASHWX_API hashwx_ctx* hashwx_alloc(hashwx_type type);
 
+/*
+ * Set the number of nonces that a HASHWX_AUTO instance hashes with the
+ * interpreter after each hashwx_make. The function is compiled before the
+ * first call that would exceed this number. Has no effect on other types.
+ *
+ * @param ctx is pointer to a HashWX instance.
+ * @param nonces is the new threshold. 0 compiles each function before it's
+ *        first used and UINT64_MAX never compiles.
+*/
+HASHWX_API void hashwx_set_jit_threshold(hashwx_ctx* ctx, uint64_t nonces);
+
+/*
+ * Share the compiled functions of a HASHWX_COMPILED instance with other
+ * processes through a directory. hashwx_make maps the cached function of
+ * the seed read-execute if there is one, otherwise it compiles the function
+ * and adds it to the directory. Cached files are never modified and can
+ * be deleted at any time. Anyone who can write to the directory can run
+ * code in the processes that use it, so it must only be writable by them.
+ * Only supported on POSIX systems with a JIT compiler.
+ *
+ * @param ctx is pointer to a HASHWX_COMPILED instance.
+ * @param dir is the path of an existing directory or NULL to stop using
+ *        the cache. Applies to the next hashwx_make.
+ *
+ * @return 1 on success, 0 if the instance type or the platform is not
+ *         supported or on memory allocation failure.
+*/
+HASHWX_API int hashwx_set_code_cache(hashwx_ctx* ctx, const char* dir);
+
 /*
  * Create a new HashWX function from a 256-bit seed.
  *
@@ -94,6 +203,341 @@ HASHWX_API void hashwx_make(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE
  s*/
 HASHWX_API uint64_t hashwx_exec(const hashwx_ctx* ctx, uint64_t input);
 
+/*
+ * Execute the HashWX function for a contiguous range of nonces.
+ * The results are identical to calling hashwx_exec for each nonce.
+ *
+ * @param ctx is pointer to a HashWX instance. A HashWX function must have
+ *        been previously created by calling hashwx_make.
+ * @param first_nonce is the first nonce to be hashed.
+ * @param count is the number of nonces to be hashed.
+ * @param out is a pointer to an array of at least count elements that will
+ *        receive the hash of first_nonce + i at index i.
+*/
+HASHWX_API void hashwx_exec_batch(const hashwx_ctx* ctx, uint64_t first_nonce, size_t count, uint64_t* out);
+
+/*
+ * Execute the HashWX function for an array of nonces.
+ * The results are identical to calling hashwx_exec for each nonce.
+ *
+ * @param ctx is pointer to a HashWX instance. A HashWX function must have
+ *        been previously created by calling hashwx_make.
+ * @param nonces is a pointer to an array of count nonces to be hashed.
+ * @param count is the number of nonces to be hashed.
+ * @param out is a pointer to an array of at least count elements that will
+ *        receive the hash of nonces[i] at index i.
+*/
+HASHWX_API void hashwx_exec_array(const hashwx_ctx* ctx, const uint64_t* nonces, size_t count, uint64_t* out);
+
+/*
+ * Search a range of nonces for the first hash value below a target.
+ *
+ * @param ctx is pointer to a HashWX instance. A HashWX function must have
+ *        been previously created by calling hashwx_make.
+ * @param start_nonce is the first nonce to be hashed.
+ * @param count is the maximum number of nonces to be hashed.
+ * @param target is the target value. The search stops at the first nonce
+ *        whose hash is less than target.
+ * @param found_nonce is a pointer that receives the nonce that was found.
+ *        Can be NULL.
+ * @param found_hash is a pointer that receives the hash of the nonce that
+ *        was found. Can be NULL.
+ *
+ * @return 1 if a nonce was found, otherwise 0.
+*/
+HASHWX_API int hashwx_search(const hashwx_ctx* ctx, uint64_t start_nonce, size_t count,
+    uint64_t target, uint64_t* found_nonce, uint64_t* found_hash);
+
+/*
+ * Calculate a single hash without a HashWX instance. This is equivalent to
+ * hashwx_make followed by hashwx_exec, but it doesn't allocate any memory
+ * and it doesn't compile the function, which makes it the fastest way to
+ * verify one nonce per seed. The function is thread-safe.
+ *
+ * @param seed is a pointer to the seed value.
+ * @param nonce is the input to be hashed (64-bit unsigned integer).
+ *
+ * @return the hash result as a 64-bit unsigned integer.
+*/
+HASHWX_API uint64_t hashwx_verify(const uint8_t seed[HASHWX_SEED_SIZE], uint64_t nonce);
+
+/*
+ * Export the HashWX function of a seed in a compact, versioned binary
+ * format. The function is thread-safe.
+ *
+ * @param seed is a pointer to the seed value.
+ * @param out is a pointer to a buffer of HASHWX_EXPORT_SIZE bytes that
+ *        receives the exported function.
+*/
+HASHWX_API void hashwx_export_program(const uint8_t seed[HASHWX_SEED_SIZE], uint8_t out[HASHWX_EXPORT_SIZE]);
+
+/*
+ * Load an exported HashWX function. This is equivalent to hashwx_make with
+ * the seed that was exported, but it doesn't generate the function.
+ *
+ * @param ctx is pointer to a HashWX instance.
+ * @param data is a pointer to HASHWX_EXPORT_SIZE bytes created by
+ *        hashwx_export_program.
+ *
+ * @return 1 on success, 0 if the data is not a valid exported function
+ *         of a supported version. In that case, ctx has no function.
+*/
+HASHWX_API int hashwx_import_program(hashwx_ctx* ctx, const uint8_t data[HASHWX_EXPORT_SIZE]);
+
+/*
+ * Export the functions of many seeds into a program pack file, which can
+ * be opened with hashwx_pack_open. Duplicate seeds are stored once.
+ *
+ * @param path is the path of the file to be created or overwritten.
+ * @param seeds is a pointer to an array of count seeds.
+ * @param count is the number of seeds.
+ *
+ * @return 1 on success, 0 on memory allocation or I/O failure.
+*/
+HASHWX_API int hashwx_pack_write(const char* path, const uint8_t (*seeds)[HASHWX_SEED_SIZE], size_t count);
+
+/*
+ * Open a program pack file. The file is memory-mapped read-only, so
+ * looking up a function doesn't copy it.
+ *
+ * @param path is the path of the file.
+ *
+ * @return pointer to the opened pack. Returns NULL if the file can't be
+ *         mapped or is not a valid pack of a supported version.
+*/
+HASHWX_API hashwx_pack* hashwx_pack_open(const char* path);
+
+/*
+ * Find the exported function of a seed in a program pack. The lookup is
+ * a binary search of the sorted seeds. The function is thread-safe.
+ *
+ * @param pack is a pointer to an opened pack.
+ * @param seed is a pointer to the seed value.
+ *
+ * @return pointer to HASHWX_EXPORT_SIZE bytes to be passed to
+ *         hashwx_import_program or NULL if the seed is not in the pack.
+ *         The pointer is valid until the pack is closed.
+*/
+HASHWX_API const uint8_t* hashwx_pack_find(const hashwx_pack* pack, const uint8_t seed[HASHWX_SEED_SIZE]);
+
+/*
+ * Close a program pack.
+ *
+ * @param pack is a pointer to an opened pack.
+*/
+HASHWX_API void hashwx_pack_close(hashwx_pack* pack);
+
+/*
+ * Allocate a multi-threaded client puzzle solver. Each worker thread keeps
+ * its own client puzzle solver (see hashwx_puzzle_alloc).
+ *
+ * @param type is the type of HashWX instances used by the workers.
+ * @param threads is the number of worker threads, including the thread
+ *        that calls hashwx_solver_run. If the library was built without
+ *        thread support, only 1 thread is used.
+ *
+ * @return pointer to a new solver. Returns NULL on memory allocation
+ *         failure or if the requested type is not supported.
+*/
+HASHWX_API hashwx_solver* hashwx_solver_alloc(hashwx_type type, int threads);
+
+/*
+ * Search for a client puzzle solution using all worker threads. The nonce
+ * range is split into windows of attempts_per_function nonces, which are
+ * balanced between the threads by work stealing. All threads stop as soon
+ * as one of them finds a solution, so the solution is not necessarily the
+ * lowest one in the range.
+ *
+ * @param solver is a pointer to a multi-threaded solver.
+ * @param challenge is a pointer to the challenge C.
+ * @param target is the target T.
+ * @param attempts_per_function is the number of nonces per function.
+ * @param start_nonce is the first nonce to be tried.
+ * @param count is the maximum number of nonces to be tried.
+ * @param progress is a callback that is periodically called from the
+ *        thread that called hashwx_solver_run. Can be NULL.
+ * @param user_data is passed to the progress callback.
+ * @param found_nonce is a pointer that receives the solution. Can be NULL.
+ * @param found_hash is a pointer that receives the hash of the solution.
+ *        Can be NULL.
+ *
+ * @return 1 if a solution was found, 0 if there is no solution in the range
+ *         and -1 if the run was cancelled.
+*/
+HASHWX_API int hashwx_solver_run(hashwx_solver* solver, const uint8_t challenge[HASHWX_CHALLENGE_SIZE],
+    uint64_t target, uint32_t attempts_per_function, uint64_t start_nonce, uint64_t count,
+    hashwx_progress_func* progress, void* user_data, uint64_t* found_nonce, uint64_t* found_hash);
+
+/*
+ * Cancel the current hashwx_solver_run call. Can be called from any thread.
+ * The worker threads stop after finishing their current window.
+ *
+ * @param solver is a pointer to a multi-threaded solver.
+*/
+HASHWX_API void hashwx_solver_cancel(hashwx_solver* solver);
+
+/*
+ * Free a multi-threaded client puzzle solver.
+ *
+ * @param solver is a pointer to a multi-threaded solver.
+*/
+HASHWX_API void hashwx_solver_free(hashwx_solver* solver);
+
+/*
+ * Allocate a batch verifier with an internal pool of worker threads.
+ * Each worker thread keeps its own HashWX instance.
+ *
+ * @param type is the type of the HashWX instances used by the workers.
+ * @param threads is the number of worker threads, including the thread
+ *        that calls hashwx_verify_many. If the library was built without
+ *        thread support, only 1 thread is used.
+ *
+ * @return pointer to a new verifier. Returns NULL on memory allocation
+ *         failure or if the requested type is not supported.
+*/
+HASHWX_API hashwx_verifier* hashwx_verifier_alloc(hashwx_type type, int threads);
+
+/*
+ * Verify an array of proofs. A proof is valid if the hash of the nonce
+ * calculated with the function created from the seed is less than the
+ * target. Proofs that share a seed are grouped, so each seed is only
+ * processed by hashwx_make once per call.
+ *
+ * @param verifier is a pointer to a verifier.
+ * @param proofs is a pointer to an array of count proofs.
+ * @param count is the number of proofs.
+ * @param results is a pointer to a bitmap of at least (count + 7) / 8 bytes.
+ *        Bit (i % 8) of results[i / 8] is set if proofs[i] is valid.
+ *
+ * @return the number of valid proofs.
+*/
+HASHWX_API size_t hashwx_verify_many(hashwx_verifier* verifier, const hashwx_proof* proofs,
+    size_t count, uint8_t* results);
+
+/*
+ * Free a batch verifier.
+ *
+ * @param verifier is a pointer to a verifier.
+*/
+HASHWX_API void hashwx_verifier_free(hashwx_verifier* verifier);
+
+/*
+ * Allocate a cache of HashWX functions keyed by seed. When the cache is
+ * full, the least recently used function is replaced. Functions are only
+ * allocated when they are first needed.
+ *
+ * @param type is the type of the cached HashWX instances.
+ * @param max_memory is the memory limit of the cached functions in bytes.
+ *        Each compiled function uses 8192 bytes of executable memory on
+ *        x86-64 and ARM64, 12288 bytes on RISC-V and 11278 bytes in
+ *        WebAssembly. Each interpreted function uses 1280 bytes. The
+ *        instance and the cache entry of each function add at most
+ *        3072 bytes. At least 1 function is always cached.
+ *
+ * @return pointer to a new cache. Returns NULL on memory allocation
+ *         failure or if the requested type is not supported. HASHWX_AUTO
+ *         is not supported because cached instances are shared by threads.
+*/
+HASHWX_API hashwx_cache* hashwx_cache_alloc(hashwx_type type, size_t max_memory);
+
+/*
+ * Calculate a hash using the cached function for the given seed. On a miss,
+ * the function is made and added to the cache. If another thread is already
+ * making the same function, the call waits for it. If all cached functions
+ * are in use or the allocation of a new function fails, the hash is
+ * calculated with hashwx_verify. The function is thread-safe.
+ *
+ * @param cache is a pointer to a cache.
+ * @param seed is a pointer to the seed value.
+ * @param nonce is the input to be hashed (64-bit unsigned integer).
+ *
+ * @return the hash result as a 64-bit unsigned integer.
+*/
+HASHWX_API uint64_t hashwx_cache_exec(hashwx_cache* cache, const uint8_t seed[HASHWX_SEED_SIZE],
+    uint64_t nonce);
+
+/*
+ * Get the hit and miss counters of a cache. The function is thread-safe.
+ *
+ * @param cache is a pointer to a cache.
+ * @param stats is a pointer where the counters will be stored.
+*/
+HASHWX_API void hashwx_cache_get_stats(hashwx_cache* cache, hashwx_cache_stats* stats);
+
+/*
+ * Free a cache and all cached functions. No other thread may be using
+ * the cache.
+ *
+ * @param cache is a pointer to a cache.
+*/
+HASHWX_API void hashwx_cache_free(hashwx_cache* cache);
+
+/*
+ * Derive the seed of a client puzzle function as sha256(C || W), where C is
+ * the challenge and W is the window index encoded as a 64-bit little endian
+ * integer. Nonce N belongs to window N / attempts_per_function.
+ *
+ * @param challenge is a pointer to the challenge.
+ * @param window is the window index.
+ * @param seed is a pointer to a buffer that receives the seed.
+*/
+HASHWX_API void hashwx_puzzle_seed(const uint8_t challenge[HASHWX_CHALLENGE_SIZE], uint64_t window,
+    uint8_t seed[HASHWX_SEED_SIZE]);
+
+/*
+ * Allocate a client puzzle solver. The solver keeps the function of the
+ * current window, so consecutive calls to hashwx_puzzle_solve within
+ * the same window don't rebuild it.
+ *
+ * @param type is the type of HashWX instance to be used.
+ *
+ * @return pointer to a new solver. Returns NULL on memory allocation
+ *         failure or if the requested type is not supported.
+*/
+HASHWX_API hashwx_puzzle* hashwx_puzzle_alloc(hashwx_type type);
+
+/*
+ * Search for a client puzzle solution, i.e. a nonce N such that H(N) < T,
+ * where H is the function made from hashwx_puzzle_seed(C, N / attempts).
+ *
+ * @param puzzle is a pointer to a client puzzle solver.
+ * @param challenge is a pointer to the challenge C.
+ * @param target is the target T.
+ * @param attempts_per_function is the number of nonces per function
+ *        (HASHWX_PUZZLE_ATTEMPTS is recommended).
+ * @param start_nonce is the first nonce to be tried.
+ * @param count is the maximum number of nonces to be tried.
+ * @param found_nonce is a pointer that receives the solution. Can be NULL.
+ * @param found_hash is a pointer that receives the hash of the solution.
+ *        Can be NULL.
+ *
+ * @return 1 if a solution was found, otherwise 0.
+*/
+HASHWX_API int hashwx_puzzle_solve(hashwx_puzzle* puzzle, const uint8_t challenge[HASHWX_CHALLENGE_SIZE],
+    uint64_t target, uint32_t attempts_per_function, uint64_t start_nonce, uint64_t count,
+    uint64_t* found_nonce, uint64_t* found_hash);
+
+/*
+ * Verify a client puzzle solution. The function doesn't allocate any
+ * memory and it is thread-safe.
+ *
+ * @param challenge is a pointer to the challenge C.
+ * @param attempts_per_function is the number of nonces per function.
+ * @param nonce is the solution to be verified.
+ * @param target is the target T.
+ *
+ * @return 1 if the solution is valid, otherwise 0.
+*/
+HASHWX_API int hashwx_puzzle_verify(const uint8_t challenge[HASHWX_CHALLENGE_SIZE],
+    uint32_t attempts_per_function, uint64_t nonce, uint64_t target);
+
+/*
+ * Free a client puzzle solver.
+ *
+ * @param puzzle is a pointer to a client puzzle solver.
+*/
+HASHWX_API void hashwx_puzzle_free(hashwx_puzzle* puzzle);
+
 /*
  * Free a HashWX instance.
  *
@@ -101,6 +545,44 @@ HASHWX_API uint64_t hashwx_exec(const hashwx_ctx* ctx, uint64_t input);
 */
 HASHWX_API void hashwx_free(hashwx_ctx* ctx);
 
+/*
+ * Get the counters of a HashWX instance since it was allocated. Counters
+ * are only collected if the library was built with the HASHWX_STATS
+ * CMake option. The function is thread-safe.
+ *
+ * @param ctx is pointer to a HashWX instance.
+ * @param stats is a pointer that receives the counters.
+ *
+ * @return 1 on success, 0 if the library was built without HASHWX_STATS.
+ *         In that case, all counters are zero.
+*/
+HASHWX_API int hashwx_get_stats(const hashwx_ctx* ctx, hashwx_stats* stats);
+
+/*
+ * Get the sum of the counters of all HashWX instances of the process,
+ * including the freed ones, and of hashwx_verify. The function is
+ * thread-safe.
+ *
+ * @param stats is a pointer that receives the counters.
+ *
+ * @return 1 on success, 0 if the library was built without HASHWX_STATS.
+ *         In that case, all counters are zero.
+*/
+HASHWX_API int hashwx_get_global_stats(hashwx_stats* stats);
+
+/*
+ * Format counters in the Prometheus text exposition format.
+ *
+ * @param stats is a pointer to the counters.
+ * @param buffer is a pointer to a buffer that receives the text, which is
+ *        always null-terminated if size > 0. Can be NULL if size is 0.
+ * @param size is the size of the buffer.
+ *
+ * @return the length of the complete text without the null terminator,
+ *         like snprintf. The text was truncated if this is >= size.
+*/
+HASHWX_API size_t hashwx_format_stats(const hashwx_stats* stats, char* buffer, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,32 @@ mergeInto(LibraryManager.library, {
     hashwx_exec: function(ctx, nonce) {
         return HWX_LIB.hashwx_exec(ctx, nonce);
     },
+    hashwx_exec_batch: function(ctx, first_nonce, count, out) {
+        let hashes = HWX_LIB.hashwx_exec_batch(ctx, first_nonce, count);
+        new BigUint64Array(HEAPU8.buffer, out, count).set(hashes);
+    },
+    hashwx_exec_array: function(ctx, nonces, count, out) {
+        let input = new BigUint64Array(HEAPU8.buffer, nonces, count).slice();
+        let hashes = HWX_LIB.hashwx_exec_array(ctx, input);
+        new BigUint64Array(HEAPU8.buffer, out, count).set(hashes);
+    },
+    hashwx_search: function(ctx, start_nonce, count, target, found_nonce, found_hash) {
+        let result = HWX_LIB.hashwx_search(ctx, start_nonce, count, target);
+        if (result === null) {
+            return 0;
+        }
+        if (found_nonce) {
+            new BigUint64Array(HEAPU8.buffer, found_nonce, 1)[0] = result.nonce;
+        }
+        if (found_hash) {
+            new BigUint64Array(HEAPU8.buffer, found_hash, 1)[0] = result.hash;
+        }
+        return 1;
+    },
+    hashwx_verify: function(seed, nonce) {
+        let seed_src = HEAPU8.slice(seed, seed + 32);
+        return HWX_LIB.hashwx_verify(seed_src, nonce);
+    },
     hashwx_free: function(ctx) {
         HWX_LIB.hashwx_free(ctx);
     }
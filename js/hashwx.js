@@ -5,6 +5,8 @@
 class hashwx {
     #imports;
     #instances = [1];
+    #buffer;
+    #buffer_size;
 
     #new_instance(ctx, seed, reg, mem, is_compiled) {
         let obj = { ctx: ctx, seed: seed, reg: reg, mem: mem, is_compiled: is_compiled }
@@ -23,12 +25,23 @@ class hashwx {
         delete this.#instances[i];
     }
 
-    hashwx_alloc(type) {
+    #init() {
         if (!this.#imports) {
             let main_module = hashwx.#create_instance();
             this.#imports = main_module.exports;
 			this.#imports._initialize();
+            this.#buffer = this.#imports.hashwx_buffer();
+            this.#buffer_size = this.#imports.hashwx_buffer_size();
         }
+    }
+
+    /* view of the WASM buffer as 64-bit words (memory growth detaches old views) */
+    #buffer_u64(offset, length) {
+        return new BigUint64Array(this.#imports.memory.buffer, this.#buffer + 8 * offset, length);
+    }
+
+    hashwx_alloc(type) {
+        this.#init();
         let ctx = this.#imports.hashwx_alloc(type);
         if (ctx <= 0) {
             return ctx;
@@ -74,6 +87,84 @@ class hashwx {
         return this.#imports.hashwx_exec_final(obj.ctx);
     }
 
+    hashwx_exec_batch(i, first_nonce, count) {
+        let obj = this.#instances[i];
+        if (!obj.is_compiled) {
+            /* the nonces are hashed in C, one call per buffer of hashes */
+            let hashes = new BigUint64Array(count);
+            let chunk = this.#buffer_size;
+            for (let j = 0; j < count; j += chunk) {
+                let n = Math.min(chunk, count - j);
+                let first = BigInt.asUintN(64, first_nonce + BigInt(j));
+                this.#imports.hashwx_exec_batch(obj.ctx, first, n, this.#buffer);
+                hashes.set(this.#buffer_u64(0, n), j);
+            }
+            return hashes;
+        }
+        let nonces = new BigUint64Array(count);
+        for (let j = 0; j < count; ++j) {
+            nonces[j] = BigInt.asUintN(64, first_nonce + BigInt(j));
+        }
+        return this.hashwx_exec_array(i, nonces);
+    }
+
+    hashwx_exec_array(i, nonces) {
+        let obj = this.#instances[i];
+        let imports = this.#imports;
+        let hashes = new BigUint64Array(nonces.length);
+        if (!obj.is_compiled) {
+            /* nonces in the first half of the buffer, hashes in the second */
+            let chunk = this.#buffer_size / 2;
+            let out = this.#buffer + 8 * chunk;
+            for (let j = 0; j < nonces.length; j += chunk) {
+                let n = Math.min(chunk, nonces.length - j);
+                this.#buffer_u64(0, n).set(nonces.subarray(j, j + n));
+                imports.hashwx_exec_array(obj.ctx, this.#buffer, n, out);
+                hashes.set(this.#buffer_u64(chunk, n), j);
+            }
+            return hashes;
+        }
+        let exec = obj.side_module.exports.exec;
+        let ctx = obj.ctx, reg = obj.reg, mem = obj.mem;
+        for (let j = 0; j < nonces.length; ++j) {
+            imports.hashwx_exec_begin(ctx, nonces[j]);
+            exec(reg, mem);
+            hashes[j] = imports.hashwx_exec_final(ctx);
+        }
+        return hashes;
+    }
+
+    hashwx_search(i, start_nonce, count, target) {
+        let obj = this.#instances[i];
+        let imports = this.#imports;
+        let nonce = BigInt.asUintN(64, start_nonce);
+        target = BigInt.asUintN(64, target);
+        if (!obj.is_compiled) {
+            /* the nonce loop and the target comparison run in C */
+            if (!imports.hashwx_search(obj.ctx, nonce, count, target, this.#buffer, this.#buffer + 8)) {
+                return null;
+            }
+            let found = this.#buffer_u64(0, 2);
+            return { nonce: found[0], hash: found[1] };
+        }
+        for (let j = 0; j < count; ++j) {
+            imports.hashwx_exec_begin(obj.ctx, nonce);
+            obj.side_module.exports.exec(obj.reg, obj.mem);
+            let hash = BigInt.asUintN(64, imports.hashwx_exec_final(obj.ctx));
+            if (hash < target) {
+                return { nonce: nonce, hash: hash };
+            }
+            nonce = BigInt.asUintN(64, nonce + 1n);
+        }
+        return null;
+    }
+
+    hashwx_verify(seed, nonce) {
+        this.#init();
+        new Uint8Array(this.#imports.memory.buffer, this.#buffer, 32).set(seed);
+        return this.#imports.hashwx_verify(this.#buffer, nonce);
+    }
+
     hashwx_free(i) {
         let obj = this.#instances[i];
         if (typeof obj == "object") {
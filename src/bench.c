@@ -1,6 +1,10 @@
 /* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
 /* See LICENSE for licensing information */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "test_utils.h"
 #include "platform.h"
 #include "siphash_rng.h"
@@ -13,6 +17,20 @@
 #else
 typedef int thrd_t;
 #endif
+#if defined(__linux__)
+#include <sched.h>
+#define HAVE_AFFINITY
+#endif
+
+/* Maximum number of logical CPUs per physical core */
+#define MAX_SMT 8
+
+typedef struct cpu_core {
+    int package;
+    int id;
+    int count;
+    int cpus[MAX_SMT];
+} cpu_core;
 
 typedef struct worker_job {
     int id;
@@ -26,6 +44,9 @@ typedef struct worker_job {
     int step;
     int end;
     int nonces;
+    int cpu;
+    int core;
+    double elapsed;
 } worker_job;
 
 static const siphash_key worker_key = {
@@ -33,8 +54,93 @@ static const siphash_key worker_key = {
     .k1 = 0x85cfeef0bcbdb1e9
 };
 
+#ifdef HAVE_AFFINITY
+static bool read_sysfs_int(int cpu, const char* name, int* value) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%i/topology/%s", cpu, name);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fscanf(file, "%i", value) == 1;
+    fclose(file);
+    return ok;
+}
+
+/*
+    Groups the online logical CPUs by physical core using the Linux sysfs
+    CPU topology. Returns the number of cores or 0 on failure.
+*/
+static int read_topology(cpu_core** cores) {
+    FILE* file = fopen("/sys/devices/system/cpu/online", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    int count = 0, capacity = 0;
+    *cores = NULL;
+    int first, last;
+    /* a list of ranges such as "0-3,6,8-11" */
+    while (fscanf(file, "%i", &first) == 1) {
+        last = first;
+        int c = fgetc(file);
+        if (c == '-') {
+            if (fscanf(file, "%i", &last) != 1) {
+                break;
+            }
+            c = fgetc(file);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            int package, id, i;
+            if (!read_sysfs_int(cpu, "physical_package_id", &package) ||
+                !read_sysfs_int(cpu, "core_id", &id)) {
+                continue;
+            }
+            for (i = 0; i < count; ++i) {
+                if ((*cores)[i].package == package && (*cores)[i].id == id) {
+                    break;
+                }
+            }
+            if (i == count) {
+                if (count == capacity) {
+                    capacity = capacity ? 2 * capacity : 16;
+                    cpu_core* grown = realloc(*cores, sizeof(cpu_core) * capacity);
+                    if (grown == NULL) {
+                        break;
+                    }
+                    *cores = grown;
+                }
+                (*cores)[count].package = package;
+                (*cores)[count].id = id;
+                (*cores)[count].count = 0;
+                count++;
+            }
+            cpu_core* core = &(*cores)[i];
+            if (core->count < MAX_SMT) {
+                core->cpus[core->count++] = cpu;
+            }
+        }
+        if (c != ',') {
+            break;
+        }
+    }
+    fclose(file);
+    return count;
+}
+#endif
+
 static int worker(void* args) {
     worker_job* job = (worker_job*)args;
+#ifdef HAVE_AFFINITY
+    if (job->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(job->cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            printf("[thread %2i] Warning: failed to pin to CPU %i\n", job->id, job->cpu);
+        }
+    }
+#endif
+    double time_start = platform_wall_clock();
     job->total_hashes = 0;
     job->best_hash = UINT64_MAX;
     job->hash_sum = 0;
@@ -58,18 +164,48 @@ static int worker(void* args) {
         }
         job->total_hashes += job->nonces;
     }
+    job->elapsed = platform_wall_clock() - time_start;
     return 0;
 }
 
 int main(int argc, char** argv) {
     int nonces, seeds, start, diff, threads;
-    bool interpret;
+    int jit_threshold, max_cores;
+    bool interpret, dual, tiered, pin, smt_pairs;
     read_int_option("--diff", argc, argv, &diff, INT_MAX);
     read_int_option("--start", argc, argv, &start, 0);
     read_int_option("--seeds", argc, argv, &seeds, 11000);
     read_int_option("--nonces", argc, argv, &nonces, 463);
-    read_int_option("--threads", argc, argv, &threads, 1);
+    read_int_option("--threads", argc, argv, &threads, 0);
     read_option("--interpret", argc, argv, &interpret);
+    read_option("--dual", argc, argv, &dual);
+    read_option("--auto", argc, argv, &tiered);
+    read_int_option("--jit-threshold", argc, argv, &jit_threshold, HASHWX_JIT_THRESHOLD);
+    read_option("--pin", argc, argv, &pin);
+    read_option("--smt-pairs", argc, argv, &smt_pairs);
+    read_int_option("--cores", argc, argv, &max_cores, INT_MAX);
+    cpu_core* cores = NULL;
+    int num_cores = 0;
+    pin = pin || smt_pairs;
+    if (pin) {
+#ifdef HAVE_AFFINITY
+        num_cores = read_topology(&cores);
+#endif
+        if (num_cores == 0) {
+            printf("Error: thread pinning requires the Linux sysfs CPU topology.\n");
+            return 1;
+        }
+        if (num_cores > max_cores) {
+            num_cores = max_cores;
+        }
+        /* one thread per core or per SMT pair by default */
+        if (threads == 0) {
+            threads = smt_pairs ? 2 * num_cores : num_cores;
+        }
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
 #if !defined(HASHWX_THREADS)
     if (threads > 1) {
         printf("Error: Your compiler doesn't support C11 threads.\n");
@@ -78,14 +214,17 @@ int main(int argc, char** argv) {
 #endif
     hashwx_type flags = HASHWX_INTERPRETED;
     if (!interpret) {
-        flags = HASHWX_COMPILED;
+        flags = tiered ? HASHWX_AUTO : HASHWX_COMPILED;
+        if (dual) {
+            flags |= HASHWX_DUAL_MAPPED;
+        }
     }
     uint64_t best_hash = UINT64_MAX;
     uint64_t diff_ex = (uint64_t)diff * 1000ULL;
     uint64_t threshold = UINT64_MAX / diff_ex;
     int seeds_end = seeds + start;
     int64_t total_hashes = 0;
-    printf("Interpret: %i, Target diff.: %" PRIu64 ", Threads: %i\n", interpret, diff_ex, threads);
+    printf("Interpret: %i, Auto: %i, Target diff.: %" PRIu64 ", Threads: %i\n", interpret, tiered, diff_ex, threads);
     printf("Testing seeds %i-%i with %i nonces each ...\n", start, seeds_end - 1, nonces);
     double time_start, time_end;
     worker_job* jobs = malloc(sizeof(worker_job) * threads);
@@ -103,12 +242,30 @@ int main(int argc, char** argv) {
             printf("Error: not supported. Try with --interpret\n");
             return 1;
         }
+        hashwx_set_jit_threshold(jobs[thd].ctx, jit_threshold);
         jobs[thd].id = thd;
         jobs[thd].start = start + thd;
         jobs[thd].step = threads;
         jobs[thd].end = seeds_end;
         jobs[thd].nonces = nonces;
         jobs[thd].threshold = threshold;
+        jobs[thd].cpu = -1;
+        jobs[thd].core = -1;
+        if (pin) {
+            /* fill the first logical CPU of each core before the siblings */
+            int core = smt_pairs ? thd / 2 % num_cores : thd % num_cores;
+            int sibling = smt_pairs ? thd % 2 : thd / num_cores;
+            jobs[thd].core = core;
+            jobs[thd].cpu = cores[core].cpus[sibling % cores[core].count];
+        }
+    }
+    if (smt_pairs) {
+        for (int core = 0; core < num_cores && core < (threads + 1) / 2; ++core) {
+            if (cores[core].count < 2) {
+                printf("Warning: core %i has no SMT sibling, both threads share CPU %i\n",
+                    core, cores[core].cpus[0]);
+            }
+        }
     }
     time_start = platform_wall_clock();
     if (threads > 1) {
@@ -145,6 +302,30 @@ int main(int argc, char** argv) {
     printf("Best hash: %016" PRIx64, best_hash);
     printf(" (diff: %" PRIu64 ")\n", UINT64_MAX / best_hash);
     printf("Hash sum: %016" PRIx64 "\n", hash_sum);
+    if (threads > 1 || pin) {
+        for (int thd = 0; thd < threads; ++thd) {
+            printf("[thread %2i] ", thd);
+            if (jobs[thd].cpu >= 0) {
+                printf("CPU %3i, core %3i: ", jobs[thd].cpu, jobs[thd].core);
+            }
+            printf("%f hashes/sec.\n", jobs[thd].total_hashes / jobs[thd].elapsed);
+        }
+    }
+    for (int core = 0; pin && core < num_cores; ++core) {
+        double rate = 0;
+        int core_threads = 0;
+        for (int thd = 0; thd < threads; ++thd) {
+            if (jobs[thd].core == core) {
+                rate += jobs[thd].total_hashes / jobs[thd].elapsed;
+                core_threads++;
+            }
+        }
+        if (core_threads > 0) {
+            printf("[core %3i] package %i, id %3i, %i thread(s): %f hashes/sec.\n",
+                core, cores[core].package, cores[core].id, core_threads, rate);
+        }
+    }
+    free(cores);
     free(jobs);
     return 0;
 }
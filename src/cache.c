@@ -0,0 +1,267 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "context.h"
+#include "compiler.h"
+#include "platform.h"
+#include "worker_pool.h"
+
+typedef struct cache_entry cache_entry;
+
+struct cache_entry {
+    uint8_t seed[HASHWX_SEED_SIZE];
+    hashwx_ctx* ctx;
+    /* next entry in the same bucket */
+    cache_entry* chain;
+    /* LRU list (most recently used first) or the list of free entries */
+    cache_entry* prev;
+    cache_entry* next;
+    /* number of threads using the function */
+    int refs;
+    /* false while the function is being made */
+    bool ready;
+};
+
+struct hashwx_cache {
+    hashwx_type type;
+    size_t capacity;
+    size_t size;
+    size_t bucket_mask;
+    cache_entry** buckets;
+    cache_entry* entries;
+    cache_entry* free_list;
+    cache_entry* head;
+    cache_entry* tail;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    hashwx_mutex lock;
+    hashwx_cond made;
+};
+
+/* the sizes are documented in hashwx_cache_alloc */
+static_assert(sizeof(cache_entry) + sizeof(hashwx_ctx) <= 3072, "cache entry overhead");
+static_assert(sizeof(hashwx_program_list) == 1280, "size of an interpreted function");
+
+static size_t entry_size(hashwx_type type) {
+    if (type & HASHWX_COMPILED) {
+        return sizeof(cache_entry) + sizeof(hashwx_ctx) + HASHWX_CODE_SIZE;
+    }
+    return sizeof(cache_entry) + sizeof(hashwx_ctx) + sizeof(hashwx_program_list);
+}
+
+static cache_entry** cache_bucket(hashwx_cache* cache, const uint8_t seed[HASHWX_SEED_SIZE]) {
+    /* seeds are usually hash outputs, so any 8 bytes will do */
+    return &cache->buckets[platform_load64(seed) & cache->bucket_mask];
+}
+
+static cache_entry* cache_find(hashwx_cache* cache, const uint8_t seed[HASHWX_SEED_SIZE]) {
+    cache_entry* entry = *cache_bucket(cache, seed);
+    while (entry != NULL && memcmp(entry->seed, seed, HASHWX_SEED_SIZE) != 0) {
+        entry = entry->chain;
+    }
+    return entry;
+}
+
+static void lru_remove(hashwx_cache* cache, cache_entry* entry) {
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    }
+    else {
+        cache->head = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+    else {
+        cache->tail = entry->prev;
+    }
+}
+
+static void lru_push(hashwx_cache* cache, cache_entry* entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head != NULL) {
+        cache->head->prev = entry;
+    }
+    else {
+        cache->tail = entry;
+    }
+    cache->head = entry;
+}
+
+static void cache_remove(hashwx_cache* cache, cache_entry* entry) {
+    cache_entry** link = cache_bucket(cache, entry->seed);
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+    lru_remove(cache, entry);
+    cache->size--;
+}
+
+/* Find an entry for a new seed. Returns NULL if all entries are in use. */
+static cache_entry* cache_claim(hashwx_cache* cache, const uint8_t seed[HASHWX_SEED_SIZE]) {
+    cache_entry* entry = cache->free_list;
+    if (entry != NULL) {
+        cache->free_list = entry->next;
+    }
+    else {
+        entry = cache->tail;
+        while (entry != NULL && entry->refs > 0) {
+            entry = entry->prev;
+        }
+        if (entry == NULL) {
+            return NULL;
+        }
+        cache_remove(cache, entry);
+        cache->evictions++;
+    }
+    memcpy(entry->seed, seed, HASHWX_SEED_SIZE);
+    cache_entry** bucket = cache_bucket(cache, seed);
+    entry->chain = *bucket;
+    *bucket = entry;
+    lru_push(cache, entry);
+    entry->refs = 1;
+    entry->ready = false;
+    cache->size++;
+    return entry;
+}
+
+hashwx_cache* hashwx_cache_alloc(hashwx_type type, size_t max_memory) {
+    /* cached functions are executed by several threads at once */
+    if (type & HASHWX_AUTO) {
+        return NULL;
+    }
+    hashwx_cache* cache = malloc(sizeof(hashwx_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    size_t capacity = max_memory / entry_size(type);
+    if (capacity < 1) {
+        capacity = 1;
+    }
+    size_t buckets = 1;
+    while (buckets < capacity) {
+        buckets *= 2;
+    }
+    cache->type = type;
+    cache->capacity = capacity;
+    cache->size = 0;
+    cache->bucket_mask = buckets - 1;
+    cache->head = NULL;
+    cache->tail = NULL;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->buckets = calloc(buckets, sizeof(cache_entry*));
+    cache->entries = calloc(capacity, sizeof(cache_entry));
+    if (cache->buckets == NULL || cache->entries == NULL) {
+        goto failure;
+    }
+    /* allocate the first function to find out if the type is supported */
+    cache->entries[0].ctx = hashwx_alloc(type);
+    if (cache->entries[0].ctx == NULL || cache->entries[0].ctx == HASHWX_NOTSUPP) {
+        goto failure;
+    }
+    cache->free_list = NULL;
+    for (size_t i = capacity; i > 0; --i) {
+        cache->entries[i - 1].next = cache->free_list;
+        cache->free_list = &cache->entries[i - 1];
+    }
+    if (!hashwx_mutex_init(&cache->lock)) {
+        goto failure_ctx;
+    }
+    if (!hashwx_cond_init(&cache->made)) {
+        hashwx_mutex_destroy(&cache->lock);
+        goto failure_ctx;
+    }
+    return cache;
+failure_ctx:
+    hashwx_free(cache->entries[0].ctx);
+failure:
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+    return NULL;
+}
+
+uint64_t hashwx_cache_exec(hashwx_cache* cache, const uint8_t seed[HASHWX_SEED_SIZE],
+    uint64_t nonce) {
+    assert(cache != NULL);
+    assert(seed != NULL);
+    hashwx_mutex_lock(&cache->lock);
+    cache_entry* entry;
+    while ((entry = cache_find(cache, seed)) != NULL && !entry->ready) {
+        /* another thread is making this function */
+        hashwx_cond_wait(&cache->made, &cache->lock);
+    }
+    if (entry != NULL) {
+        cache->hits++;
+        entry->refs++;
+        lru_remove(cache, entry);
+        lru_push(cache, entry);
+        hashwx_mutex_unlock(&cache->lock);
+    }
+    else {
+        cache->misses++;
+        entry = cache_claim(cache, seed);
+        hashwx_mutex_unlock(&cache->lock);
+        if (entry == NULL) {
+            return hashwx_verify(seed, nonce);
+        }
+        if (entry->ctx == NULL) {
+            entry->ctx = hashwx_alloc(cache->type);
+        }
+        if (entry->ctx == NULL) {
+            hashwx_mutex_lock(&cache->lock);
+            cache_remove(cache, entry);
+            entry->next = cache->free_list;
+            cache->free_list = entry;
+            hashwx_cond_broadcast(&cache->made);
+            hashwx_mutex_unlock(&cache->lock);
+            return hashwx_verify(seed, nonce);
+        }
+        hashwx_make(entry->ctx, seed);
+        hashwx_mutex_lock(&cache->lock);
+        entry->ready = true;
+        hashwx_cond_broadcast(&cache->made);
+        hashwx_mutex_unlock(&cache->lock);
+    }
+    uint64_t hash = hashwx_exec(entry->ctx, nonce);
+    hashwx_mutex_lock(&cache->lock);
+    entry->refs--;
+    hashwx_mutex_unlock(&cache->lock);
+    return hash;
+}
+
+void hashwx_cache_get_stats(hashwx_cache* cache, hashwx_cache_stats* stats) {
+    assert(cache != NULL);
+    assert(stats != NULL);
+    hashwx_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->entries = cache->size;
+    stats->capacity = cache->capacity;
+    hashwx_mutex_unlock(&cache->lock);
+}
+
+void hashwx_cache_free(hashwx_cache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        hashwx_free(cache->entries[i].ctx);
+    }
+    hashwx_cond_destroy(&cache->made);
+    hashwx_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
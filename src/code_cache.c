@@ -0,0 +1,214 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "code_cache.h"
+#include "compiler.h"
+#include "context.h"
+#include "platform.h"
+#include "perf_map.h"
+
+/*
+    Code cache file format:
+
+    0-7      'H', 'W', 'X', 'C', 'O', 'D', 'E', CACHE_VERSION
+    8-11     HASHWX_CODE_SIZE in little endian
+    12-15    architecture name, see CACHE_ARCH
+    16-47    seed
+    48-63    zero
+    64-      compiled function, HASHWX_CODE_SIZE bytes
+
+    The file of a seed is named "<seed in hex>.<architecture>". It's
+    written to a temporary file first and then renamed, so other processes
+    either map the complete file or don't find it. The compiled code only
+    uses relative addresses, so it runs from any mapping. Files can be
+    deleted at any time, processes that have them mapped are not affected.
+
+    The file is mapped read-execute with the same lifetime as the function,
+    so hashwx_make unmaps the previous file of the instance.
+*/
+
+#if HASHWX_COMPILER && !defined(HASHWX_COMPILER_WASM) && !defined(HASHWX_WIN)
+#define HAVE_CODE_CACHE
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define CACHE_VERSION 2
+#define CACHE_HEADER_SIZE 64
+#define CACHE_FILE_SIZE (CACHE_HEADER_SIZE + HASHWX_CODE_SIZE)
+
+#if defined(HASHWX_COMPILER_X86)
+#define CACHE_ARCH "x64"
+#elif defined(HASHWX_COMPILER_A64)
+#define CACHE_ARCH "a64"
+#else
+#define CACHE_ARCH "rv64"
+#endif
+
+/* hex seed, '.', architecture */
+#define CACHE_NAME_SIZE (2 * HASHWX_SEED_SIZE + 1 + 4)
+/* '.' prefix and mkstemp suffix of temporary files */
+#define CACHE_PATH_EXTRA (1 + 7)
+
+static const uint8_t cache_magic[8] = { 'H', 'W', 'X', 'C', 'O', 'D', 'E', CACHE_VERSION };
+static const char cache_arch[] = CACHE_ARCH;
+
+int hashwx_set_code_cache(hashwx_ctx* ctx, const char* dir) {
+    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+#ifdef HAVE_CODE_CACHE
+    if (!(ctx->type & HASHWX_COMPILED) || (ctx->type & HASHWX_AUTO)) {
+        return 0;
+    }
+    char* path = NULL;
+    if (dir != NULL) {
+        size_t dir_len = strlen(dir);
+        path = malloc(dir_len + 1 + CACHE_PATH_EXTRA + CACHE_NAME_SIZE + 1);
+        if (path == NULL) {
+            return 0;
+        }
+        memcpy(path, dir, dir_len);
+        path[dir_len] = '/';
+        path[dir_len + 1] = '\0';
+    }
+    free(ctx->cache_path);
+    ctx->cache_path = path;
+    return 1;
+#else
+    (void)dir;
+    return 0;
+#endif
+}
+
+#ifdef HAVE_CODE_CACHE
+
+static void make_header(const uint8_t seed[HASHWX_SEED_SIZE], uint8_t header[CACHE_HEADER_SIZE]) {
+    memset(header, 0, CACHE_HEADER_SIZE);
+    memcpy(&header[0], cache_magic, sizeof(cache_magic));
+    platform_store32(&header[8], HASHWX_CODE_SIZE);
+    memcpy(&header[12], cache_arch, sizeof(cache_arch) - 1);
+    memcpy(&header[16], seed, HASHWX_SEED_SIZE);
+}
+
+/* Appends the file name of seed to the directory in ctx->cache_path */
+static void make_name(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE], bool temporary) {
+    static const char hex[] = "0123456789abcdef";
+    char* p = strrchr(ctx->cache_path, '/') + 1;
+    if (temporary) {
+        *p++ = '.';
+    }
+    for (int i = 0; i < HASHWX_SEED_SIZE; ++i) {
+        *p++ = hex[seed[i] >> 4];
+        *p++ = hex[seed[i] & 15];
+    }
+    *p++ = '.';
+    strcpy(p, CACHE_ARCH);
+    if (temporary) {
+        strcat(p, ".XXXXXX");
+    }
+}
+
+static bool write_all(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+#endif
+
+void hashwx_code_cache_release(hashwx_ctx* ctx) {
+#ifdef HAVE_CODE_CACHE
+    if (ctx->cache_file != NULL) {
+        munmap((void*)ctx->cache_file, CACHE_FILE_SIZE);
+        ctx->cache_file = NULL;
+        ctx->code_exec = ctx->exec_view;
+    }
+#else
+    (void)ctx;
+#endif
+}
+
+bool hashwx_code_cache_load(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE]) {
+    hashwx_code_cache_release(ctx);
+#ifdef HAVE_CODE_CACHE
+    make_name(ctx, seed, false);
+    int fd = open(ctx->cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    void* mem = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == CACHE_FILE_SIZE) {
+        mem = mmap(NULL, CACHE_FILE_SIZE, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED) {
+            /* e.g. a noexec file system, don't try again */
+            free(ctx->cache_path);
+            ctx->cache_path = NULL;
+        }
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+    uint8_t header[CACHE_HEADER_SIZE];
+    make_header(seed, header);
+    if (memcmp(mem, header, CACHE_HEADER_SIZE) != 0) {
+        munmap(mem, CACHE_FILE_SIZE);
+        return false;
+    }
+    ctx->cache_file = mem;
+    ctx->code_exec = (uint8_t*)mem + CACHE_HEADER_SIZE;
+    hashwx_perf_map_add(ctx->code_exec);
+    return true;
+#else
+    (void)seed;
+    return false;
+#endif
+}
+
+void hashwx_code_cache_store(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE]) {
+#ifdef HAVE_CODE_CACHE
+    make_name(ctx, seed, true);
+    int fd = mkstemp(ctx->cache_path);
+    if (fd == -1) {
+        return;
+    }
+    uint8_t header[CACHE_HEADER_SIZE];
+    make_header(seed, header);
+    /* mkstemp creates files that only the owner can read */
+    bool ok = fchmod(fd, 0644) == 0 &&
+        write_all(fd, header, sizeof(header)) &&
+        write_all(fd, ctx->code, HASHWX_CODE_SIZE);
+    ok = close(fd) == 0 && ok;
+    char* temp_path = strdup(ctx->cache_path);
+    if (temp_path == NULL) {
+        unlink(ctx->cache_path);
+        return;
+    }
+    make_name(ctx, seed, false);
+    if (!ok || rename(temp_path, ctx->cache_path) != 0) {
+        unlink(temp_path);
+    }
+    free(temp_path);
+#else
+    (void)ctx;
+    (void)seed;
+#endif
+}
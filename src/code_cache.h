@@ -0,0 +1,18 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef CODE_CACHE_H
+#define CODE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <hashwx.h>
+
+/* Maps the cached function of seed, returns false if it's not cached */
+HASHWX_PRIVATE bool hashwx_code_cache_load(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE]);
+/* Writes the function compiled in ctx->code to the cache */
+HASHWX_PRIVATE void hashwx_code_cache_store(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE]);
+/* Unmaps the cached function, so that ctx->func runs ctx->code again */
+HASHWX_PRIVATE void hashwx_code_cache_release(hashwx_ctx* ctx);
+
+#endif
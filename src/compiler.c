@@ -9,21 +9,80 @@
 #include <stdlib.h>
 #else
 #include "virtual_memory.h"
+#include "perf_map.h"
 #endif
 
 bool hashwx_compiler_init(hashwx_ctx* ctx) {
 #ifdef HASHWX_COMPILER_WASM
     ctx->code = malloc(HASHWX_CODE_SIZE);
+    ctx->exec_view = ctx->code;
+    ctx->code_exec = ctx->exec_view;
 #else
+    if (ctx->type & HASHWX_DUAL_MAPPED) {
+        ctx->code = hashwx_vm_alloc_dual(HASHWX_CODE_SIZE, (void**)&ctx->exec_view);
+        if (ctx->code != NULL) {
+            ctx->code_exec = ctx->exec_view;
+            hashwx_perf_map_add(ctx->exec_view);
+            return true;
+        }
+        /* fall back to a single mapping */
+        ctx->type &= ~HASHWX_DUAL_MAPPED;
+    }
     ctx->code = hashwx_vm_alloc(HASHWX_CODE_SIZE);
+    ctx->exec_view = ctx->code;
+    ctx->code_exec = ctx->exec_view;
+    if (ctx->code != NULL) {
+        hashwx_perf_map_add(ctx->exec_view);
+    }
 #endif
     return ctx->code != NULL;
 }
 
+static void begin_write(hashwx_ctx* ctx) {
+#ifndef HASHWX_COMPILER_WASM
+    /* a dual mapped buffer is always writable through ctx->code */
+    if (!(ctx->type & HASHWX_DUAL_MAPPED)) {
+        hashwx_vm_rw(ctx->code, HASHWX_CODE_SIZE);
+    }
+#else
+    (void)ctx;
+#endif
+}
+
+static void end_write(hashwx_ctx* ctx) {
+#ifndef HASHWX_COMPILER_WASM
+    if (!(ctx->type & HASHWX_DUAL_MAPPED)) {
+        hashwx_vm_rx(ctx->code, HASHWX_CODE_SIZE);
+    }
+#if (defined(HASHWX_COMPILER_A64) || defined(HASHWX_COMPILER_RV64)) && defined(__GNUC__)
+    __builtin___clear_cache((char*)ctx->exec_view, (char*)ctx->exec_view + HASHWX_CODE_SIZE);
+#endif
+#else
+    (void)ctx;
+#endif
+}
+
+void hashwx_compiler_make(hashwx_ctx* ctx, const hashwx_program_list* program_list) {
+    begin_write(ctx);
+    hashwx_compile(ctx->code, program_list);
+    end_write(ctx);
+}
+
+void hashwx_compiler_make_fused(hashwx_ctx* ctx, const siphash_key* key) {
+    begin_write(ctx);
+    hashwx_compile_fused(ctx->code, key);
+    end_write(ctx);
+}
+
 void hashwx_compiler_destroy(hashwx_ctx* ctx) {
 #ifdef HASHWX_COMPILER_WASM
     free(ctx->code);
 #else
-    hashwx_vm_free(ctx->code, HASHWX_CODE_SIZE);
+    if (ctx->type & HASHWX_DUAL_MAPPED) {
+        hashwx_vm_free_dual(ctx->code, ctx->exec_view, HASHWX_CODE_SIZE);
+    }
+    else {
+        hashwx_vm_free(ctx->code, HASHWX_CODE_SIZE);
+    }
 #endif
 }
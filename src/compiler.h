@@ -9,40 +9,102 @@
 #include <hashwx.h>
 
 typedef struct hashwx_program_list hashwx_program_list;
+typedef struct siphash_key siphash_key;
+
+/* Byte offsets of the parts of a compiled function */
+typedef struct hashwx_code_layout {
+    /* the program function starts at 0 with the prologue */
+    uint32_t epilogue;
+    /* start of the body called by the program function or 0 if the body
+       is inlined between the prologue and the epilogue */
+    uint32_t body;
+    uint32_t reg_phase;
+    uint32_t reg_program_size;
+    uint32_t mem_phase;
+    uint32_t mem_program_size;
+    /* entry point of the nonce loop or 0 */
+    uint32_t loop;
+    uint32_t size;
+} hashwx_code_layout;
+
+/*
+    Arguments of the nonce loop of compiled code. Starting at index, the
+    loop hashes the nonces first + index, or inputs[index] if inputs isn't
+    NULL, stores the hashes in out unless it's NULL and stops at the first
+    hash below target or when index reaches count. index must be below
+    count on entry. On return, index is the index of the hash below target
+    or count, and hash is the last hash. The offsets of the fields are
+    part of the emitted code.
+*/
+typedef struct hashwx_loop_args {
+    uint64_t init[4];   /* 0: siphash state of the key, see hashwx_rng_init */
+    uint64_t k0, k1;    /* 32 */
+    uint64_t first;     /* 48 */
+    const uint64_t* inputs; /* 56 */
+    uint64_t* out;      /* 64 */
+    uint64_t target;    /* 72 */
+    uint64_t count;     /* 80 */
+    uint64_t index;     /* 88 */
+    uint64_t hash;      /* 96 */
+} hashwx_loop_args;
+
+typedef void hashwx_loop_func(hashwx_loop_args* args);
 
 HASHWX_PRIVATE void hashwx_compile_x86(uint8_t* code, const hashwx_program_list* program_list);
+HASHWX_PRIVATE void hashwx_compile_x86_fused(uint8_t* code, const siphash_key* key);
+HASHWX_PRIVATE extern const hashwx_code_layout hashwx_layout_x86;
 
 HASHWX_PRIVATE void hashwx_compile_a64(uint8_t* code, const hashwx_program_list* program_list);
+HASHWX_PRIVATE void hashwx_compile_a64_fused(uint8_t* code, const siphash_key* key);
+HASHWX_PRIVATE extern const hashwx_code_layout hashwx_layout_a64;
+
+HASHWX_PRIVATE void hashwx_compile_rv64(uint8_t* code, const hashwx_program_list* program_list);
+HASHWX_PRIVATE void hashwx_compile_rv64_fused(uint8_t* code, const siphash_key* key);
+HASHWX_PRIVATE extern const hashwx_code_layout hashwx_layout_rv64;
 
 HASHWX_PRIVATE void hashwx_compile_wasm(uint8_t* code, const hashwx_program_list* program_list);
+HASHWX_PRIVATE void hashwx_compile_wasm_fused(uint8_t* code, const siphash_key* key);
 
 #if defined(_M_X64) || defined(__x86_64__)
 #define HASHWX_COMPILER 1
 #define HASHWX_COMPILER_X86
 #define hashwx_compile hashwx_compile_x86
+#define hashwx_compile_fused hashwx_compile_x86_fused
+#define hashwx_layout hashwx_layout_x86
+#define HASHWX_COMPILER_LOOP
 #define HASHWX_CODE_SIZE 8192
 #elif defined(__aarch64__)
 #define HASHWX_COMPILER 1
 #define HASHWX_COMPILER_A64
 #define hashwx_compile hashwx_compile_a64
+#define hashwx_compile_fused hashwx_compile_a64_fused
+#define hashwx_layout hashwx_layout_a64
+#define HASHWX_COMPILER_LOOP
 #define HASHWX_CODE_SIZE 8192
 #elif defined(__riscv_xlen) && __riscv_xlen == 64 && defined(__riscv_zbb)
-#define HASHWX_COMPILER 0
+#define HASHWX_COMPILER 1
 #define HASHWX_COMPILER_RV64
-#define hashwx_compile
-#define HASHWX_CODE_SIZE 8192
+#define hashwx_compile hashwx_compile_rv64
+#define hashwx_compile_fused hashwx_compile_rv64_fused
+#define hashwx_layout hashwx_layout_rv64
+#define HASHWX_CODE_SIZE 12288
 #elif defined(__wasm__)
 #define HASHWX_COMPILER 1
 #define HASHWX_COMPILER_WASM
 #define hashwx_compile hashwx_compile_wasm
+#define hashwx_compile_fused hashwx_compile_wasm_fused
 #define HASHWX_CODE_SIZE 11278
 #else
 #define HASHWX_COMPILER 0
 #define hashwx_compile(code, program_list)
+#define hashwx_compile_fused(code, key)
 #define HASHWX_CODE_SIZE 0
 #endif
 
 HASHWX_PRIVATE bool hashwx_compiler_init(hashwx_ctx* compiler);
+HASHWX_PRIVATE void hashwx_compiler_make(hashwx_ctx* compiler, const hashwx_program_list* program_list);
+/* Generates and compiles the program list of key in a single pass */
+HASHWX_PRIVATE void hashwx_compiler_make_fused(hashwx_ctx* compiler, const siphash_key* key);
 HASHWX_PRIVATE void hashwx_compiler_destroy(hashwx_ctx* compiler);
 
 #endif
@@ -10,7 +10,6 @@
 
 #include "program.h"
 #include "platform.h"
-#include "virtual_memory.h"
 
 #define EMIT(p,x) do {           \
         memcpy(p, &x, sizeof(x)); \
@@ -31,26 +30,46 @@
         x12     = R8
         x13     = R9
         x14-x17 = temporary
+
+    Code layout:
+        code_prologue, code_epilogue: the program function, it loads the
+                                      registers and calls the body
+        code_body_begin
+        register phase
+        code_clear_bc
+        memory phase
+        code_body_end
+        nonce loop:                   see compile_loop
 */
 
 static const uint8_t code_prologue[] = {
+    0xfe, 0x0f, 0x1f, 0xf8, /* str x30, [sp, #-16]! */
     0x0c, 0x34, 0x44, 0xa9, /* ldp x12, x13, [x0, #64] */
     0xe8, 0x03, 0x00, 0xaa, /* mov x8, x0 */
     0x06, 0x1c, 0x43, 0xa9, /* ldp x6, x7, [x0, #48] */
     0x04, 0x14, 0x42, 0xa9, /* ldp x4, x5, [x0, #32] */
     0x02, 0x0c, 0x41, 0xa9, /* ldp x2, x3, [x0, #16] */
     0x00, 0x04, 0x40, 0xa9, /* ldp x0, x1, [x0, #0] */
-    0x09, 0x00, 0x80, 0xd2, /* mov x9, 0 */
-    0x2a, 0x01, 0x80, 0xd2, /* mov x10, 9 */
-    0x2b, 0x04, 0x80, 0xd2, /* mov x11, 33 */
+    0x00, 0x00, 0x00, 0x94, /* bl body */
 };
 
 static const uint8_t code_epilogue[] = {
     0x06, 0x1d, 0x03, 0xa9, /* stp x6, x7, [x8, #48] */
-    0xff, 0x03, 0x20, 0x91, /* add sp, sp, 2048 */
     0x04, 0x15, 0x02, 0xa9, /* stp x4, x5, [x8, #32] */
     0x02, 0x0d, 0x01, 0xa9, /* stp x2, x3, [x8, #16] */
     0x00, 0x05, 0x00, 0xa9, /* stp x0, x1, [x8, #0] */
+    0xfe, 0x07, 0x41, 0xf8, /* ldr x30, [sp], #16 */
+    0xc0, 0x03, 0x5f, 0xd6, /* ret */
+};
+
+static const uint8_t code_body_begin[] = {
+    0x09, 0x00, 0x80, 0xd2, /* mov x9, 0 */
+    0x2a, 0x01, 0x80, 0xd2, /* mov x10, 9 */
+    0x2b, 0x04, 0x80, 0xd2, /* mov x11, 33 */
+};
+
+static const uint8_t code_body_end[] = {
+    0xff, 0x03, 0x20, 0x91, /* add sp, sp, 2048 */
     0xc0, 0x03, 0x5f, 0xd6, /* ret */
 };
 
@@ -73,38 +92,39 @@ static uint8_t* emit_ror(uint8_t* pos, uint32_t dst, uint32_t count) {
     return pos;
 }
 
-static uint8_t* emit_lsr(uint8_t* pos, uint32_t dst, uint32_t count) {
-    EMIT_ISN(pos, 0xd340fc00 | (count << 16) | (dst << 5) | (dst));
-    return pos;
-}
-
-static uint8_t* emit_asr(uint8_t* pos, uint32_t dst, uint32_t count) {
-    EMIT_ISN(pos, 0x9340fc00 | (count << 16) | (dst << 5) | (dst));
-    return pos;
-}
-
 static uint8_t* emit_mov(uint8_t* pos, uint32_t dst, uint32_t src) {
     EMIT_ISN(pos, 0xaa0003e0 | (src << 16) | (dst));
     return pos;
 }
 
-static uint8_t* emit_sub(uint8_t* pos, uint32_t dst, uint32_t src) {
-    EMIT_ISN(pos, 0xcb000000 | (src << 16) | (dst << 5) | (dst));
+static uint8_t* emit_orr(uint8_t* pos, uint32_t dst, uint32_t src1, uint32_t src2) {
+    EMIT_ISN(pos, 0xaa000000 | (src2 << 16) | (src1 << 5) | (dst));
     return pos;
 }
 
-static uint8_t* emit_add(uint8_t* pos, uint32_t dst, uint32_t src) {
-    EMIT_ISN(pos, 0x8b000000 | (src << 16) | (dst << 5) | (dst));
+static uint8_t* emit_add(uint8_t* pos, uint32_t dst, uint32_t src1, uint32_t src2) {
+    EMIT_ISN(pos, 0x8b000000 | (src2 << 16) | (src1 << 5) | (dst));
     return pos;
 }
 
-static uint8_t* emit_eor(uint8_t* pos, uint32_t dst, uint32_t src) {
-    EMIT_ISN(pos, 0xca000000 | (src << 16) | (dst << 5) | (dst));
+static uint8_t* emit_eor_ror(uint8_t* pos, uint32_t dst, uint32_t src1, uint32_t src2, uint32_t count) {
+    /* eor dst, src1, src2, ror count */
+    EMIT_ISN(pos, 0xcac00000 | (src2 << 16) | (count << 10) | (src1 << 5) | (dst));
     return pos;
 }
 
-static uint8_t* emit_orr(uint8_t* pos, uint32_t dst, uint32_t src1, uint32_t src2) {
-    EMIT_ISN(pos, 0xaa000000 | (src2 << 16) | (src1 << 5) | (dst));
+/* SIPROUND, the rotations of v1 and v3 are merged into the xors */
+static uint8_t* emit_sipround(uint8_t* pos, uint32_t v0, uint32_t v1, uint32_t v2, uint32_t v3) {
+    pos = emit_add(pos, v0, v0, v1);
+    pos = emit_add(pos, v2, v2, v3);
+    pos = emit_eor_ror(pos, v1, v0, v1, 64 - 13);
+    pos = emit_eor_ror(pos, v3, v2, v3, 64 - 16);
+    pos = emit_ror(pos, v0, 32);
+    pos = emit_add(pos, v2, v2, v1);
+    pos = emit_add(pos, v0, v0, v3);
+    pos = emit_eor_ror(pos, v1, v2, v1, 64 - 17);
+    pos = emit_eor_ror(pos, v3, v0, v3, 64 - 21);
+    pos = emit_ror(pos, v2, 32);
     return pos;
 }
 
@@ -137,36 +157,64 @@ static uint8_t* emit_premul(uint8_t* pos, const instruction* isn) {
     return pos;
 }
 
+/*
+    Stencils of the XAS instructions, indexed by opcode - INSTR_XORROR.
+    The operand fields of the templates are cleared. The dst operand is
+    patched by multiplication (it may occupy the Rd, Rn and Rm fields at
+    once) and the imm operand by a shift.
+*/
+typedef struct xas_stencil {
+    uint32_t pre;       /* ror/asr/lsr dst, dst, imm */
+    uint32_t pre_dst;   /* dst multiplier of pre */
+    uint32_t pre_imm;   /* imm shift of pre */
+    uint32_t op;        /* eor/add/sub dst, dst, src */
+} xas_stencil;
+
+#define STENCIL_ROR(op) { 0x93c00000, 0x10021, 10, op } /* extr */
+#define STENCIL_ASR(op) { 0x9340fc00, 0x21, 16, op } /* sbfm */
+#define STENCIL_LSR(op) { 0xd340fc00, 0x21, 16, op } /* ubfm */
+
+#define OP_EOR 0xca000000
+#define OP_ADD 0x8b000000
+#define OP_SUB 0xcb000000
+
+static const xas_stencil xas_stencils[9] = {
+    STENCIL_ROR(OP_EOR), STENCIL_ROR(OP_ADD), STENCIL_ROR(OP_SUB),
+    STENCIL_ASR(OP_EOR), STENCIL_ASR(OP_ADD), STENCIL_ASR(OP_SUB),
+    STENCIL_LSR(OP_EOR), STENCIL_LSR(OP_ADD), STENCIL_LSR(OP_SUB),
+};
+
 static uint8_t* emit_pre_xas(uint8_t* pos, const instruction* isn) {
-    switch ((isn->opcode - 4) / 3) {
-    case 0:
-        return emit_ror(pos, isn->dst, isn->imm);
-    case 1:
-        return emit_asr(pos, isn->dst, isn->imm);
-    case 2:
-        return emit_lsr(pos, isn->dst, isn->imm);
-    default:
-        UNREACHABLE;
-    }
+    const xas_stencil* st = &xas_stencils[isn->opcode - INSTR_XORROR];
+    EMIT_ISN(pos, st->pre | (isn->dst * st->pre_dst) | (isn->imm << st->pre_imm));
+    return pos;
 }
 
 static uint8_t* emit_xas(uint8_t* pos, const instruction* isn, uint32_t src) {
-    switch ((isn->opcode - 4) % 3) {
-    case 0:
-        return emit_eor(pos, isn->dst, src);
-    case 1:
-        return emit_add(pos, isn->dst, src);
-    case 2:
-        return emit_sub(pos, isn->dst, src);
-    default:
-        UNREACHABLE;
-    }
+    const xas_stencil* st = &xas_stencils[isn->opcode - INSTR_XORROR];
+    EMIT_ISN(pos, st->op | (src << 16) | (isn->dst << 5) | (isn->dst));
+    return pos;
 }
 
-static uint8_t* emit_beq(uint8_t* pos, uint8_t* target) {
+#define COND_EQ 0x0
+#define COND_NE 0x1
+#define COND_LO 0x3
+
+static uint8_t* emit_bcond(uint8_t* pos, uint32_t cond, uint8_t* target) {
     uint32_t offset = (uint32_t)(target - pos);
     offset &= 0x1ffffc;
-    EMIT_ISN(pos, 0x54000000 | (offset << 3));
+    EMIT_ISN(pos, 0x54000000 | (offset << 3) | cond);
+    return pos;
+}
+
+static uint8_t* emit_beq(uint8_t* pos, uint8_t* target) {
+    return emit_bcond(pos, COND_EQ, target);
+}
+
+static uint8_t* emit_bl(uint8_t* pos, uint8_t* target) {
+    uint32_t offset = (uint32_t)(target - pos);
+    offset = (offset >> 2) & 0x3ffffff;
+    EMIT_ISN(pos, 0x94000000 | offset);
     return pos;
 }
 
@@ -316,26 +364,181 @@ static uint8_t* compile_program_mem(const hashwx_program* program, uint8_t* pos)
 }
 
 
-void hashwx_compile_a64(uint8_t* code, const hashwx_program_list* program_list) {
-    hashwx_vm_rw(code, HASHWX_CODE_SIZE);
+/*
+    The code of every program has a fixed size, so the register phase and
+    the memory phase of a program are compiled at the same time, each at
+    its own position in the code buffer.
+*/
+#define REG_PROGRAM_SIZE 104
+#define MEM_PROGRAM_SIZE 136
+#define BODY_OFFSET (sizeof(code_prologue) + sizeof(code_epilogue))
+#define REG_PHASE_OFFSET (BODY_OFFSET + sizeof(code_body_begin))
+#define MEM_PHASE_OFFSET (REG_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * REG_PROGRAM_SIZE + sizeof(code_clear_bc))
+#define BODY_END_OFFSET (MEM_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * MEM_PROGRAM_SIZE)
+#define LOOP_OFFSET (BODY_END_OFFSET + sizeof(code_body_end))
+#define LOOP_SIZE 388
+
+static FORCE_INLINE void compile_program(const hashwx_program* program, uint8_t* code, uint32_t index) {
+    uint8_t* reg_code = code + REG_PHASE_OFFSET + index * REG_PROGRAM_SIZE;
+    uint8_t* pos = compile_program_reg(program, reg_code);
+    assert(pos - reg_code == REG_PROGRAM_SIZE);
+    uint8_t* mem_code = code + MEM_PHASE_OFFSET + index * MEM_PROGRAM_SIZE;
+    pos = compile_program_mem(program, mem_code);
+    assert(pos - mem_code == MEM_PROGRAM_SIZE);
+}
+
+/*
+    The nonce loop, x8 points to hashwx_loop_args. The registers are
+    initialized like init_registers does (R0-R3 are the siphash state
+    v3-v0 after hashwx_rng_init and R4-R7 the state v3-v0 after
+    hashwx_rng_mix), the body is called and the hash is computed like
+    finalize_registers does.
+*/
+static uint8_t* compile_loop(uint8_t* pos, uint8_t* body) {
+    /* str x30, [sp, #-16]! */
+    EMIT_ISN(pos, 0xf81f0ffe);
+    /* mov x8, x0 */
+    EMIT_ISN(pos, 0xaa0003e8);
+    /* ldr x15, [x8, #88] */
+    EMIT_ISN(pos, 0xf9402d0f);
+    uint8_t* next = pos;
+    /* ldr x14, [x8, #56] */
+    EMIT_ISN(pos, 0xf9401d0e);
+    /* ldr x16, [x8, #48] */
+    EMIT_ISN(pos, 0xf9401910);
+    /* add x16, x16, x15 */
+    EMIT_ISN(pos, 0x8b0f0210);
+    /* cbz x14, nonce */
+    EMIT_ISN(pos, 0xb400004e);
+    /* ldr x16, [x14, x15, lsl #3] */
+    EMIT_ISN(pos, 0xf86f79d0);
+    /* nonce: ldp x3, x2, [x8] */
+    EMIT_ISN(pos, 0xa9400903);
+    /* ldp x1, x0, [x8, #16] */
+    EMIT_ISN(pos, 0xa9410101);
+    /* eor x0, x0, x16 */
+    EMIT_ISN(pos, 0xca100000);
+    pos = emit_sipround(pos, 3, 2, 1, 0);
+    /* eor x3, x3, x16 */
+    EMIT_ISN(pos, 0xca100063);
+    /* mov x17, 0xbb */
+    EMIT_ISN(pos, 0xd2801771);
+    /* eor x1, x1, x17 */
+    EMIT_ISN(pos, 0xca110021);
+    /* mov x9, 3 */
+    EMIT_ISN(pos, 0xd2800069);
+    uint8_t* init = pos;
+    pos = emit_sipround(pos, 3, 2, 1, 0);
+    /* subs x9, x9, 1 */
+    EMIT_ISN(pos, 0xf1000529);
+    pos = emit_bcond(pos, COND_NE, init);
+    /* ldp x16, x17, [x8, #32] */
+    EMIT_ISN(pos, 0xa9424510);
+    /* eor x7, x3, x16 */
+    EMIT_ISN(pos, 0xca100067);
+    /* eor x6, x2, x17 */
+    EMIT_ISN(pos, 0xca110046);
+    /* eor x5, x1, x16 */
+    EMIT_ISN(pos, 0xca100025);
+    /* eor x4, x0, x17 */
+    EMIT_ISN(pos, 0xca110004);
+    /* mov x9, 4 */
+    EMIT_ISN(pos, 0xd2800089);
+    uint8_t* mix = pos;
+    pos = emit_sipround(pos, 7, 6, 5, 4);
+    /* subs x9, x9, 1 */
+    EMIT_ISN(pos, 0xf1000529);
+    pos = emit_bcond(pos, COND_NE, mix);
+    /* (x | 7) ^ 4 == (x & -8) | 3 */
+    /* orr x12, x4, 7 */
+    EMIT_ISN(pos, 0xb240088c);
+    /* eor x12, x12, 4 */
+    EMIT_ISN(pos, 0xd27e018c);
+    /* orr x13, x7, 7 */
+    EMIT_ISN(pos, 0xb24008ed);
+    /* eor x13, x13, 2 */
+    EMIT_ISN(pos, 0xd27f01ad);
+    pos = emit_bl(pos, body);
+    pos = emit_sipround(pos, 0, 1, 2, 3);
+    pos = emit_sipround(pos, 4, 5, 6, 7);
+    /* eor x14, x3, x7 */
+    EMIT_ISN(pos, 0xca07006e);
+    /* eor x14, x14, x13 */
+    EMIT_ISN(pos, 0xca0d01ce);
+    /* str x14, [x8, #96] */
+    EMIT_ISN(pos, 0xf900310e);
+    /* ldr x15, [x8, #88] */
+    EMIT_ISN(pos, 0xf9402d0f);
+    /* ldr x16, [x8, #64] */
+    EMIT_ISN(pos, 0xf9402110);
+    /* cbz x16, skip */
+    EMIT_ISN(pos, 0xb4000050);
+    /* str x14, [x16, x15, lsl #3] */
+    EMIT_ISN(pos, 0xf82f7a0e);
+    /* skip: ldr x17, [x8, #72] */
+    EMIT_ISN(pos, 0xf9402511);
+    /* cmp x14, x17 */
+    EMIT_ISN(pos, 0xeb1101df);
+    /* b.lo done */
+    EMIT_ISN(pos, 0x540000c3);
+    /* add x15, x15, 1 */
+    EMIT_ISN(pos, 0x910005ef);
+    /* str x15, [x8, #88] */
+    EMIT_ISN(pos, 0xf9002d0f);
+    /* ldr x17, [x8, #80] */
+    EMIT_ISN(pos, 0xf9402911);
+    /* cmp x15, x17 */
+    EMIT_ISN(pos, 0xeb1101ff);
+    pos = emit_bcond(pos, COND_LO, next);
+    /* done: ldr x30, [sp], #16 */
+    EMIT_ISN(pos, 0xf84107fe);
+    /* ret */
+    EMIT_ISN(pos, 0xd65f03c0);
+    return pos;
+}
+
+static void compile_fixed(uint8_t* code) {
     uint8_t* pos = code;
     EMIT(pos, code_prologue);
+    emit_bl(pos - 4, code + BODY_OFFSET);
+    EMIT(pos, code_epilogue);
+    EMIT(pos, code_body_begin);
+    pos = code + MEM_PHASE_OFFSET - sizeof(code_clear_bc);
+    EMIT(pos, code_clear_bc);
+    pos = code + BODY_END_OFFSET;
+    EMIT(pos, code_body_end);
+    pos = compile_loop(pos, code + BODY_OFFSET);
+    assert(pos - code == LOOP_OFFSET + LOOP_SIZE);
+    assert(pos - code <= HASHWX_CODE_SIZE);
+}
+
+const hashwx_code_layout hashwx_layout_a64 = {
+    .epilogue = sizeof(code_prologue),
+    .body = BODY_OFFSET,
+    .reg_phase = REG_PHASE_OFFSET,
+    .reg_program_size = REG_PROGRAM_SIZE,
+    .mem_phase = MEM_PHASE_OFFSET,
+    .mem_program_size = MEM_PROGRAM_SIZE,
+    .loop = LOOP_OFFSET,
+    .size = LOOP_OFFSET + LOOP_SIZE,
+};
 
+void hashwx_compile_a64(uint8_t* code, const hashwx_program_list* program_list) {
+    compile_fixed(code);
     for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
-        pos = compile_program_reg(&program_list->prog[i], pos);
+        compile_program(&program_list->prog[i], code, i);
     }
+}
 
-    EMIT(pos, code_clear_bc);
-
+void hashwx_compile_a64_fused(uint8_t* code, const siphash_key* key) {
+    siphash_rng gen;
+    hashwx_program program;
+    compile_fixed(code);
+    hashwx_program_gen_init(key, &gen);
     for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
-        pos = compile_program_mem(&program_list->prog[i], pos);
+        hashwx_program_generate(&gen, &program);
+        compile_program(&program, code, i);
     }
-
-    EMIT(pos, code_epilogue);
-    hashwx_vm_rx(code, HASHWX_CODE_SIZE);
-#ifdef __GNUC__
-    __builtin___clear_cache((char*)code, (char*)pos);
-#endif
 }
 
 #endif
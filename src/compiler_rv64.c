@@ -0,0 +1,296 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include "compiler.h"
+
+#ifdef HASHWX_COMPILER_RV64
+
+#include <string.h>
+#include <assert.h>
+
+#include "program.h"
+#include "platform.h"
+
+#define EMIT(p,x) do {           \
+        memcpy(p, &x, sizeof(x)); \
+        p += sizeof(x);          \
+    } while (0)
+#define EMIT_ISN(p,x) do {       \
+        uint32_t a = x;          \
+        EMIT(p, a);              \
+    } while (0)
+
+/*
+    RV64 register allocation (only caller-saved registers are used):
+        x10-x17 (a0-a7) = R0-R7
+        x28 (t3)        = R8
+        x29 (t4)        = R9
+        x30 (t5)        = 32-BC
+        x31 (t6)        = in/out ptr
+        x5-x7 (t0-t2)   = temporary
+
+    The scratchpad occupies 2048 bytes of the stack, mem[i] is at sp + 8*i.
+*/
+
+#define REG_R0 10
+#define REG_R8 28
+#define REG_BC 30
+#define REG_PTR 31
+#define REG_T0 5
+#define REG_T1 6
+#define REG_SP 2
+
+#define OP_IMM 0x13
+#define OP_REG 0x33
+#define OP_LOAD 0x03
+#define OP_STORE 0x23
+#define OP_BRANCH 0x63
+
+static const uint8_t code_prologue[] = {
+    0x93, 0x0f, 0x05, 0x00, /* mv t6, a0 */
+    0x03, 0x3e, 0x05, 0x04, /* ld t3, 64(a0) */
+    0x83, 0x3e, 0x85, 0x04, /* ld t4, 72(a0) */
+    0x83, 0x38, 0x85, 0x03, /* ld a7, 56(a0) */
+    0x03, 0x38, 0x05, 0x03, /* ld a6, 48(a0) */
+    0x83, 0x37, 0x85, 0x02, /* ld a5, 40(a0) */
+    0x03, 0x37, 0x05, 0x02, /* ld a4, 32(a0) */
+    0x83, 0x36, 0x85, 0x01, /* ld a3, 24(a0) */
+    0x03, 0x36, 0x05, 0x01, /* ld a2, 16(a0) */
+    0x83, 0x35, 0x85, 0x00, /* ld a1, 8(a0) */
+    0x03, 0x35, 0x05, 0x00, /* ld a0, 0(a0) */
+    0x13, 0x0f, 0x00, 0x00, /* li t5, 0 */
+    0x13, 0x01, 0x01, 0x80, /* addi sp, sp, -2048 */
+};
+
+static const uint8_t code_epilogue[] = {
+    0x13, 0x01, 0x01, 0x40, /* addi sp, sp, 1024 */
+    0x13, 0x01, 0x01, 0x40, /* addi sp, sp, 1024 */
+    0x23, 0xb0, 0xaf, 0x00, /* sd a0, 0(t6) */
+    0x23, 0xb4, 0xbf, 0x00, /* sd a1, 8(t6) */
+    0x23, 0xb8, 0xcf, 0x00, /* sd a2, 16(t6) */
+    0x23, 0xbc, 0xdf, 0x00, /* sd a3, 24(t6) */
+    0x23, 0xb0, 0xef, 0x02, /* sd a4, 32(t6) */
+    0x23, 0xb4, 0xff, 0x02, /* sd a5, 40(t6) */
+    0x23, 0xb8, 0x0f, 0x03, /* sd a6, 48(t6) */
+    0x23, 0xbc, 0x1f, 0x03, /* sd a7, 56(t6) */
+    0x67, 0x80, 0x00, 0x00, /* ret */
+};
+
+static const uint8_t code_clear_bc[] = {
+    0x13, 0x0f, 0x00, 0x00, /* li t5, 0 */
+};
+
+static uint8_t* emit_r_type(uint8_t* pos, uint32_t funct, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+    /* funct = (funct7 << 25) | (funct3 << 12) */
+    EMIT_ISN(pos, funct | (rs2 << 20) | (rs1 << 15) | (rd << 7) | OP_REG);
+    return pos;
+}
+
+static uint8_t* emit_i_type(uint8_t* pos, uint32_t opcode, uint32_t funct3, uint32_t rd, uint32_t rs1, uint32_t imm) {
+    EMIT_ISN(pos, (imm << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode);
+    return pos;
+}
+
+static uint8_t* emit_mul(uint8_t* pos, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+    return emit_r_type(pos, 0x02000000, rd, rs1, rs2);
+}
+
+static uint8_t* emit_rori(uint8_t* pos, uint32_t rd, uint32_t rs1, uint32_t count) {
+    /* Zbb */
+    return emit_i_type(pos, OP_IMM, 5, rd, rs1, 0x600 | count);
+}
+
+static uint8_t* emit_srai(uint8_t* pos, uint32_t rd, uint32_t rs1, uint32_t count) {
+    return emit_i_type(pos, OP_IMM, 5, rd, rs1, 0x400 | count);
+}
+
+static uint8_t* emit_srli(uint8_t* pos, uint32_t rd, uint32_t rs1, uint32_t count) {
+    return emit_i_type(pos, OP_IMM, 5, rd, rs1, count);
+}
+
+static uint8_t* emit_or(uint8_t* pos, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+    return emit_r_type(pos, 0x00006000, rd, rs1, rs2);
+}
+
+static uint8_t* emit_andi(uint8_t* pos, uint32_t rd, uint32_t rs1, uint32_t imm) {
+    return emit_i_type(pos, OP_IMM, 7, rd, rs1, imm);
+}
+
+static uint8_t* emit_ld(uint8_t* pos, uint32_t rd, uint32_t rs1, uint32_t offset) {
+    return emit_i_type(pos, OP_LOAD, 3, rd, rs1, offset);
+}
+
+static uint8_t* emit_sd(uint8_t* pos, uint32_t rs2, uint32_t rs1, uint32_t offset) {
+    EMIT_ISN(pos, ((offset >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (3 << 12) | ((offset & 31) << 7) | OP_STORE);
+    return pos;
+}
+
+/* ori/xori/addi, indexed by opcode */
+static const uint32_t premul_funct3[3] = {
+    6, 4, 0
+};
+
+/* xor/add/sub */
+static const uint32_t xas_funct[3] = {
+    0x00004000, 0x00000000, 0x40000000
+};
+
+static uint8_t* emit_pre_xas(uint8_t* pos, const instruction* isn, uint32_t rd) {
+    uint32_t dst = REG_R0 + isn->dst;
+    switch ((isn->opcode - 4) / 3) {
+    case 0:
+        return emit_rori(pos, rd, dst, isn->imm);
+    case 1:
+        return emit_srai(pos, rd, dst, isn->imm);
+    case 2:
+        return emit_srli(pos, rd, dst, isn->imm);
+    default:
+        UNREACHABLE;
+    }
+}
+
+/*
+    All instructions except INSTR_RMCG read the pre-op value into a
+    temporary register first, so they are correct even if src == dst.
+*/
+
+static uint8_t* emit_xas(uint8_t* pos, const instruction* isn, uint32_t src) {
+    /* ror/asr/lsr t0, dst, imm */
+    pos = emit_pre_xas(pos, isn, REG_T0);
+    /* xor/add/sub dst, t0, src */
+    return emit_r_type(pos, xas_funct[(isn->opcode - 4) % 3], REG_R0 + isn->dst, REG_T0, src);
+}
+
+static uint8_t* emit_mul_imm(uint8_t* pos, const instruction* isn, uint32_t src) {
+    /* ori/xori/addi t0, dst, imm */
+    pos = emit_i_type(pos, OP_IMM, premul_funct3[isn->opcode], REG_T0, REG_R0 + isn->dst, isn->imm);
+    /* mul dst, t0, src */
+    return emit_mul(pos, REG_R0 + isn->dst, REG_T0, src);
+}
+
+static uint8_t* emit_rmcg(uint8_t* pos, const instruction* isn) {
+    uint32_t dst = REG_R0 + isn->dst;
+    /* mul dst0, dst0, R8/R9 */
+    pos = emit_mul(pos, dst, dst, REG_R8 + isn->src - 8);
+    /* rori dst0, dst0, imm0 */
+    return emit_rori(pos, dst, dst, isn->imm);
+}
+
+static uint8_t* emit_load_mem(uint8_t* pos, uint32_t rd, uint32_t src) {
+    /* andi rd, src, 2040 */
+    pos = emit_andi(pos, rd, REG_R0 + src, 2040);
+    /* add rd, rd, sp */
+    pos = emit_r_type(pos, 0, rd, rd, REG_SP);
+    /* ld rd, 0(rd) */
+    return emit_ld(pos, rd, rd, 0);
+}
+
+static uint8_t* emit_branch(uint8_t* pos, const instruction* isn, uint8_t* target) {
+    /*
+        The branch is taken if BC != 0 and bit 5 of the flag is clear.
+        t5 = 32-BC is in the range 0-32, so both conditions are tested
+        at once by or-ing t5 with the flag.
+    */
+    /* or t0, dst0, t5 */
+    pos = emit_or(pos, REG_T0, REG_R0 + isn->dst, REG_BC);
+    /* andi t0, t0, 32 */
+    pos = emit_andi(pos, REG_T0, REG_T0, 32);
+    /* seqz t1, t0 */
+    pos = emit_i_type(pos, OP_IMM, 3, REG_T1, REG_T0, 1);
+    /* add t5, t5, t1 */
+    pos = emit_r_type(pos, 0, REG_BC, REG_BC, REG_T1);
+    /* beqz t0, target */
+    uint32_t offset = (uint32_t)(target - pos);
+    EMIT_ISN(pos, ((offset >> 12) & 1) << 31 | ((offset >> 5) & 63) << 25 | (REG_T0 << 15) |
+        ((offset >> 1) & 15) << 8 | ((offset >> 11) & 1) << 7 | OP_BRANCH);
+    return pos;
+}
+
+static uint8_t* compile_program_reg(const hashwx_program* program, uint8_t* pos, uint32_t index) {
+    uint8_t* target = pos;
+    pos = emit_rmcg(pos, &program->code[0]);
+    for (int i = 1; i < 7; i += 2) {
+        pos = emit_xas(pos, &program->code[i], REG_R0 + program->code[i].src);
+        pos = emit_mul_imm(pos, &program->code[i + 1], REG_R0 + program->code[i + 1].src);
+    }
+    pos = emit_branch(pos, &program->code[0], target);
+    pos = emit_xas(pos, &program->code[8], REG_R0 + program->code[8].src);
+    /* mem[255 - 8 * index - j] = R[j] */
+    for (uint32_t j = 0; j < 8; ++j) {
+        pos = emit_sd(pos, REG_R0 + j, REG_SP, 8 * (HASHWX_MEM_SIZE - 1 - 8 * index - j));
+    }
+    return pos;
+}
+
+static uint8_t* compile_program_mem(const hashwx_program* program, uint8_t* pos) {
+    uint8_t* target = pos;
+    pos = emit_rmcg(pos, &program->code[0]);
+    for (int i = 1; i < 7; i += 2) {
+        pos = emit_load_mem(pos, REG_T1, program->code[i].src);
+        pos = emit_xas(pos, &program->code[i], REG_T1);
+        pos = emit_load_mem(pos, REG_T1, program->code[i + 1].src);
+        pos = emit_mul_imm(pos, &program->code[i + 1], REG_T1);
+    }
+    pos = emit_branch(pos, &program->code[0], target);
+    pos = emit_load_mem(pos, REG_T1, program->code[8].src);
+    pos = emit_xas(pos, &program->code[8], REG_T1);
+    return pos;
+}
+
+/*
+    The code of every program has a fixed size, so the register phase and
+    the memory phase of a program are compiled at the same time, each at
+    its own position in the code buffer.
+*/
+#define REG_PROGRAM_SIZE 116
+#define MEM_PROGRAM_SIZE 168
+#define REG_PHASE_OFFSET sizeof(code_prologue)
+#define MEM_PHASE_OFFSET (REG_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * REG_PROGRAM_SIZE + sizeof(code_clear_bc))
+
+static FORCE_INLINE void compile_program(const hashwx_program* program, uint8_t* code, uint32_t index) {
+    uint8_t* reg_code = code + REG_PHASE_OFFSET + index * REG_PROGRAM_SIZE;
+    uint8_t* pos = compile_program_reg(program, reg_code, index);
+    assert(pos - reg_code == REG_PROGRAM_SIZE);
+    uint8_t* mem_code = code + MEM_PHASE_OFFSET + index * MEM_PROGRAM_SIZE;
+    pos = compile_program_mem(program, mem_code);
+    assert(pos - mem_code == MEM_PROGRAM_SIZE);
+}
+
+static void compile_fixed(uint8_t* code) {
+    uint8_t* pos = code;
+    EMIT(pos, code_prologue);
+    pos = code + MEM_PHASE_OFFSET - sizeof(code_clear_bc);
+    EMIT(pos, code_clear_bc);
+    pos = code + MEM_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * MEM_PROGRAM_SIZE;
+    EMIT(pos, code_epilogue);
+    assert(pos - code <= HASHWX_CODE_SIZE);
+}
+
+const hashwx_code_layout hashwx_layout_rv64 = {
+    .epilogue = MEM_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * MEM_PROGRAM_SIZE,
+    .reg_phase = REG_PHASE_OFFSET,
+    .reg_program_size = REG_PROGRAM_SIZE,
+    .mem_phase = MEM_PHASE_OFFSET,
+    .mem_program_size = MEM_PROGRAM_SIZE,
+    .size = MEM_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * MEM_PROGRAM_SIZE + sizeof(code_epilogue),
+};
+
+void hashwx_compile_rv64(uint8_t* code, const hashwx_program_list* program_list) {
+    compile_fixed(code);
+    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        compile_program(&program_list->prog[i], code, i);
+    }
+}
+
+void hashwx_compile_rv64_fused(uint8_t* code, const siphash_key* key) {
+    siphash_rng gen;
+    hashwx_program program;
+    compile_fixed(code);
+    hashwx_program_gen_init(key, &gen);
+    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        hashwx_program_generate(&gen, &program);
+        compile_program(&program, code, i);
+    }
+}
+
+#endif
@@ -17,8 +17,8 @@
     } while (0)
 #define EMIT_BYTE(p,x) *((p)++) = x
 
-#define WASM_REG_PROGRAM_SIZE 173
-#define WASM_MEM_PROGRAM_SIZE 179
+#define WASM_REG_PROGRAM_SIZE 170
+#define WASM_MEM_PROGRAM_SIZE 176
 
 #define WASM_BINARY_MAGIC 0x00, 0x61, 0x73, 0x6d
 #define WASM_BINARY_VERSION 0x01, 0x00, 0x00, 0x00
@@ -407,22 +407,45 @@ static uint8_t* compile_program_mem(const hashwx_program* program, uint8_t* code
     return pos;
 }
 
-void hashwx_compile_wasm(uint8_t* code, const hashwx_program_list* program_list) {
+/*
+    The code of every program has a fixed size, so the register phase and
+    the memory phase of a program are compiled at the same time, each at
+    its own position in the module.
+*/
+#define REG_PHASE_OFFSET sizeof(code_prologue)
+#define MEM_PHASE_OFFSET (REG_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * WASM_REG_PROGRAM_SIZE + sizeof(code_clear_bc))
+
+static FORCE_INLINE void compile_program(const hashwx_program* program, uint8_t* code, uint32_t index) {
+    compile_program_reg(program, code + REG_PHASE_OFFSET + index * WASM_REG_PROGRAM_SIZE);
+    compile_program_mem(program, code + MEM_PHASE_OFFSET + index * WASM_MEM_PROGRAM_SIZE);
+}
+
+static void compile_fixed(uint8_t* code) {
     uint8_t* pos = code;
     EMIT(pos, code_prologue);
+    pos = code + MEM_PHASE_OFFSET - sizeof(code_clear_bc);
+    EMIT(pos, code_clear_bc);
+    pos = code + MEM_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * WASM_MEM_PROGRAM_SIZE;
+    EMIT(pos, code_epilogue);
+    assert(pos - code == HASHWX_CODE_SIZE);
+}
 
+void hashwx_compile_wasm(uint8_t* code, const hashwx_program_list* program_list) {
+    compile_fixed(code);
     for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
-        pos = compile_program_reg(&program_list->prog[i], pos);
+        compile_program(&program_list->prog[i], code, i);
     }
+}
 
-    EMIT(pos, code_clear_bc);
-
+void hashwx_compile_wasm_fused(uint8_t* code, const siphash_key* key) {
+    siphash_rng gen;
+    hashwx_program program;
+    compile_fixed(code);
+    hashwx_program_gen_init(key, &gen);
     for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
-        pos = compile_program_mem(&program_list->prog[i], pos);
+        hashwx_program_generate(&gen, &program);
+        compile_program(&program, code, i);
     }
-
-    EMIT(pos, code_epilogue);
-    assert(pos - code == HASHWX_CODE_SIZE);
 }
 
 #endif
@@ -6,10 +6,10 @@
 #ifdef HASHWX_COMPILER_X86
 
 #include <string.h>
+#include <assert.h>
 
 #include "platform.h"
 #include "program.h"
-#include "virtual_memory.h"
 
 #if defined(_WIN32) || defined(__CYGWIN__)
 #define WINABI
@@ -32,6 +32,16 @@
         rsi    = R8
         rdi    = R9
         r8-r15 = R0-R7
+
+    Code layout:
+        code_prologue, code_epilogue: the program function, it loads the
+                                      registers and calls the body
+        code_body_begin
+        register phase
+        code_clear_bc
+        memory phase
+        code_body_end
+        code_loop_*:                  the nonce loop, see hashwx_loop_args
 */
 
 static const uint8_t code_prologue[] = {
@@ -57,12 +67,10 @@ static const uint8_t code_prologue[] = {
     0x4c, 0x8b, 0x79, 0x38, /* mov r15, qword ptr [rcx+56] */
     0x48, 0x8b, 0x71, 0x40, /* mov rsi, qword ptr [rcx+64] */
     0x48, 0x8b, 0x79, 0x48, /* mov rdi, qword ptr [rcx+72] */
-    0x31, 0xdb, /* xor ebx, ebx */
-    0x8d, 0x6b, 0x01 /* lea ebp, [rbx+1] */
+    0xe8, 0x00, 0x00, 0x00, 0x00 /* call body */
 };
 
 static const uint8_t code_epilogue[] = {
-    0x48, 0x81, 0xc4, 0x00, 0x08, 0x00, 0x00, /* add rsp, 2048 */
     0x4c, 0x89, 0x01, /* mov qword ptr [rcx], r8 */
     0x4c, 0x89, 0x49, 0x08, /* mov qword ptr [rcx+8], r9 */
     0x4c, 0x89, 0x51, 0x10, /* mov qword ptr [rcx+16], r10 */
@@ -84,9 +92,129 @@ static const uint8_t code_epilogue[] = {
     0xc3 /* ret */
 };
 
-static const uint8_t code_target[] = {
-    0x85, 0xed, /* test ebp, ebp */
-    0x0f, 0x44, 0xdd /* cmovz ebx, ebp */
+static const uint8_t code_body_begin[] = {
+    0x31, 0xdb, /* xor ebx, ebx */
+    0x8d, 0x6b, 0x01 /* lea ebp, [rbx+1] */
+};
+
+static const uint8_t code_body_end[] = {
+    0x48, 0x81, 0xc4, 0x00, 0x08, 0x00, 0x00, /* add rsp, 2048 */
+    0xc3 /* ret */
+};
+
+/* add/xor/rol of R0-R7 (r8-r15) */
+#define SIP_ADD(dst, src) 0x4d, 0x01, 0xc0 | (src) << 3 | (dst)
+#define SIP_XOR(dst, src) 0x4d, 0x31, 0xc0 | (src) << 3 | (dst)
+#define SIP_ROL(dst, imm) 0x49, 0xc1, 0xc0 | (dst), imm
+
+/* SIPROUND of R0-R7, 48 bytes */
+#define SIPROUND_X86(v0, v1, v2, v3) \
+    SIP_ADD(v0, v1), SIP_ADD(v2, v3), SIP_ROL(v1, 13), SIP_ROL(v3, 16), \
+    SIP_XOR(v1, v0), SIP_XOR(v3, v2), SIP_ROL(v0, 32), SIP_ADD(v2, v1), \
+    SIP_ADD(v0, v3), SIP_ROL(v1, 17), SIP_ROL(v3, 21), SIP_XOR(v1, v2), \
+    SIP_XOR(v3, v0), SIP_ROL(v2, 32)
+
+/*
+    The nonce loop. rcx points to hashwx_loop_args. The registers are
+    initialized like init_registers does (R0-R3 are the siphash state
+    v3-v0 after hashwx_rng_init and R4-R7 the state v3-v0 after
+    hashwx_rng_mix), the body is called and the hash is computed like
+    finalize_registers does.
+*/
+static const uint8_t code_loop_prologue[] = {
+#ifdef WINABI
+    0x56, /* push rsi */
+    0x57, /* push rdi */
+#else
+    0x48, 0x89, 0xf9, /* mov rcx, rdi */
+#endif
+    0x53, /* push rbx */
+    0x55, /* push rbp */
+    0x41, 0x54, /* push r12 */
+    0x41, 0x55, /* push r13 */
+    0x41, 0x56, /* push r14 */
+    0x41, 0x57, /* push r15 */
+    0x48, 0x8b, 0x41, 0x58, /* mov rax, qword ptr [rcx+88] */
+};
+
+static const uint8_t code_loop_begin[] = {
+    /* next: */
+    0x48, 0x8b, 0x51, 0x38, /* mov rdx, qword ptr [rcx+56] */
+    0x48, 0x85, 0xd2, /* test rdx, rdx */
+    0x74, 0x06, /* jz range */
+    0x48, 0x8b, 0x14, 0xc2, /* mov rdx, qword ptr [rdx+rax*8] */
+    0xeb, 0x07, /* jmp nonce */
+    /* range: */
+    0x48, 0x8b, 0x51, 0x30, /* mov rdx, qword ptr [rcx+48] */
+    0x48, 0x01, 0xc2, /* add rdx, rax */
+    /* nonce: */
+    0x4c, 0x8b, 0x59, 0x00, /* mov r11, qword ptr [rcx] */
+    0x4c, 0x8b, 0x51, 0x08, /* mov r10, qword ptr [rcx+8] */
+    0x4c, 0x8b, 0x49, 0x10, /* mov r9, qword ptr [rcx+16] */
+    0x4c, 0x8b, 0x41, 0x18, /* mov r8, qword ptr [rcx+24] */
+    0x49, 0x31, 0xd0, /* xor r8, rdx */
+    SIPROUND_X86(3, 2, 1, 0),
+    0x49, 0x31, 0xd3, /* xor r11, rdx */
+    0x49, 0x81, 0xf1, 0xbb, 0x00, 0x00, 0x00, /* xor r9, 0xbb */
+    0xbb, 0x03, 0x00, 0x00, 0x00, /* mov ebx, 3 */
+    /* init: */
+    SIPROUND_X86(3, 2, 1, 0),
+    0xff, 0xcb, /* dec ebx */
+    0x75, 0xcc, /* jnz init */
+    0x4d, 0x89, 0xdf, /* mov r15, r11 */
+    0x4c, 0x33, 0x79, 0x20, /* xor r15, qword ptr [rcx+32] */
+    0x4d, 0x89, 0xd6, /* mov r14, r10 */
+    0x4c, 0x33, 0x71, 0x28, /* xor r14, qword ptr [rcx+40] */
+    0x4d, 0x89, 0xcd, /* mov r13, r9 */
+    0x4c, 0x33, 0x69, 0x20, /* xor r13, qword ptr [rcx+32] */
+    0x4d, 0x89, 0xc4, /* mov r12, r8 */
+    0x4c, 0x33, 0x61, 0x28, /* xor r12, qword ptr [rcx+40] */
+    0xbb, 0x04, 0x00, 0x00, 0x00, /* mov ebx, 4 */
+    /* mix: */
+    SIPROUND_X86(7, 6, 5, 4),
+    0xff, 0xcb, /* dec ebx */
+    0x75, 0xcc, /* jnz mix */
+    0x4c, 0x89, 0xe6, /* mov rsi, r12 */
+    0x48, 0x83, 0xe6, 0xf8, /* and rsi, -8 */
+    0x48, 0x83, 0xce, 0x03, /* or rsi, 3 */
+    0x4c, 0x89, 0xff, /* mov rdi, r15 */
+    0x48, 0x83, 0xe7, 0xf8, /* and rdi, -8 */
+    0x48, 0x83, 0xcf, 0x05, /* or rdi, 5 */
+    0xe8, 0x00, 0x00, 0x00, 0x00 /* call body */
+};
+
+static const uint8_t code_loop_end[] = {
+    SIPROUND_X86(0, 1, 2, 3),
+    SIPROUND_X86(4, 5, 6, 7),
+    0x4c, 0x89, 0xd8, /* mov rax, r11 */
+    0x4c, 0x31, 0xf8, /* xor rax, r15 */
+    0x48, 0x31, 0xf8, /* xor rax, rdi */
+    0x48, 0x89, 0x41, 0x60, /* mov qword ptr [rcx+96], rax */
+    0x48, 0x8b, 0x51, 0x40, /* mov rdx, qword ptr [rcx+64] */
+    0x48, 0x8b, 0x59, 0x58, /* mov rbx, qword ptr [rcx+88] */
+    0x48, 0x85, 0xd2, /* test rdx, rdx */
+    0x74, 0x04, /* jz skip */
+    0x48, 0x89, 0x04, 0xda, /* mov qword ptr [rdx+rbx*8], rax */
+    /* skip: */
+    0x48, 0x3b, 0x41, 0x48, /* cmp rax, qword ptr [rcx+72] */
+    0x72, 0x14, /* jb done */
+    0x48, 0xff, 0xc3, /* inc rbx */
+    0x48, 0x89, 0x59, 0x58, /* mov qword ptr [rcx+88], rbx */
+    0x48, 0x89, 0xd8, /* mov rax, rbx */
+    0x48, 0x3b, 0x59, 0x50, /* cmp rbx, qword ptr [rcx+80] */
+    0x0f, 0x82, 0x00, 0x00, 0x00, 0x00, /* jb next */
+    /* done: */
+    0x41, 0x5f, /* pop r15 */
+    0x41, 0x5e, /* pop r14 */
+    0x41, 0x5d, /* pop r13 */
+    0x41, 0x5c, /* pop r12 */
+    0x5d, /* pop rbp */
+    0x5b, /* pop rbx */
+#ifdef WINABI
+    0x5f, /* pop rdi */
+    0x5e, /* pop rsi */
+#endif
+    0xc3 /* ret */
 };
 
 static const uint8_t code_branch[] = {
@@ -106,259 +234,305 @@ static const uint8_t code_store[] = {
     0x41, 0x57  /* push r15 */
 };
 
-static const uint8_t code_address[] = {
-    0x25, 0xf8, 07, 00, 00 /* and eax, 2040 */
-};
-
 static const uint8_t code_clear_bc[] = {
     0x31, 0xdb /* xor ebx, ebx */
 };
 
-static const uint32_t tpl_mul[] = {
-    0x00c88349, /* or */
-    0x00f08349, /* xor */
-    0x00c08349  /* add */
-};
+static inline uint8_t* emit_jz(uint8_t* pos, uint8_t* targetp2) {
+    uint32_t offset = (uint32_t)(targetp2 - pos);
+    uint16_t isn;
+    if (offset >= (uint32_t)-128) {
+        isn = 0x0074;
+        isn |= offset << 8;
+        EMIT(pos, isn);
+    }
+    else {
+        offset -= 4;
+        isn = 0x840f;
+        EMIT(pos, isn);
+        EMIT(pos, offset);
+    }
+    return pos;
+}
 
-static const uint32_t tpl_pre_xas[] = {
-    0x00c8c149, /* ror */
-    0x00f8c149, /* sar */
-    0x00e8c149  /* shr */
-};
+/*
+    Stencil compiler. A stencil is the complete machine code of one VM
+    instruction with all operand fields cleared. All opcodes of a slot of
+    the fixed program layout (see hashwx_program_generate) share the same
+    code size and patch offsets, so compiling an instruction is a table
+    lookup, a fixed-size copy and a few byte stores at constant offsets.
+*/
 
-static const uint16_t tpl_xas_reg[] = {
-    0xc031, /* xor */
-    0xc001, /* add */
-    0xc029  /* sub */
+#define STENCIL_SIZE 24
+
+typedef struct stencil {
+    uint8_t code[STENCIL_SIZE];
+} stencil;
+
+/* or/xor/add r64, imm8 */
+#define MODRM_OR  0xc8
+#define MODRM_XOR 0xf0
+#define MODRM_ADD 0xc0
+/* ror/sar/shr r64, imm8 */
+#define MODRM_ROR 0xc8
+#define MODRM_SAR 0xf8
+#define MODRM_SHR 0xe8
+/* xor/add/sub r/m64, r64 */
+#define OP_XOR_RM 0x31
+#define OP_ADD_RM 0x01
+#define OP_SUB_RM 0x29
+/* xor/add/sub r64, r/m64 */
+#define OP_XOR_R 0x33
+#define OP_ADD_R 0x03
+#define OP_SUB_R 0x2b
+
+#define STENCIL_RMCG { { \
+        0x85, 0xed,             /* test ebp, ebp */ \
+        0x0f, 0x44, 0xdd,       /* cmovz ebx, ebp */ \
+        0x4c, 0x0f, 0xaf, 0xc6, /* imul dst, rsi/rdi */ \
+        0x49, 0xc1, 0xc8, 0x00, /* ror dst, imm */ \
+        0x4c, 0x89, 0xc2,       /* mov rdx, dst */ \
+    } }
+
+#define STENCIL_MUL_REG(modrm) { { \
+        0x49, 0x83, modrm, 0x00, /* or/xor/add dst, imm */ \
+        0x4d, 0x0f, 0xaf, 0xc0,  /* imul dst, src */ \
+    } }
+
+#define STENCIL_XAS_REG(modrm, op) { { \
+        0x49, 0xc1, modrm, 0x00, /* ror/sar/shr dst, imm */ \
+        0x4d, op, 0xc0,          /* xor/add/sub dst, src */ \
+    } }
+
+#define STENCIL_MUL_MEM(modrm) { { \
+        0x4c, 0x89, 0xc0,             /* mov rax, src */ \
+        0x49, 0x83, modrm, 0x00,      /* or/xor/add dst, imm */ \
+        0x25, 0xf8, 0x07, 0x00, 0x00, /* and eax, 2040 */ \
+        0x4c, 0x0f, 0xaf, 0x04, 0x04, /* imul dst, qword ptr [rsp+rax] */ \
+    } }
+
+#define STENCIL_XAS_MEM(modrm, op) { { \
+        0x4c, 0x89, 0xc0,             /* mov rax, src */ \
+        0x49, 0xc1, modrm, 0x00,      /* ror/sar/shr dst, imm */ \
+        0x25, 0xf8, 0x07, 0x00, 0x00, /* and eax, 2040 */ \
+        0x4c, op, 0x04, 0x04,         /* xor/add/sub dst, qword ptr [rsp+rax] */ \
+    } }
+
+/* indexed by opcode */
+static const stencil stencils_reg[INSTR_BRANCH] = {
+    [INSTR_MULOR] = STENCIL_MUL_REG(MODRM_OR),
+    [INSTR_MULXOR] = STENCIL_MUL_REG(MODRM_XOR),
+    [INSTR_MULADD] = STENCIL_MUL_REG(MODRM_ADD),
+    [INSTR_RMCG] = STENCIL_RMCG,
+    [INSTR_XORROR] = STENCIL_XAS_REG(MODRM_ROR, OP_XOR_RM),
+    [INSTR_ADDROR] = STENCIL_XAS_REG(MODRM_ROR, OP_ADD_RM),
+    [INSTR_SUBROR] = STENCIL_XAS_REG(MODRM_ROR, OP_SUB_RM),
+    [INSTR_XORASR] = STENCIL_XAS_REG(MODRM_SAR, OP_XOR_RM),
+    [INSTR_ADDASR] = STENCIL_XAS_REG(MODRM_SAR, OP_ADD_RM),
+    [INSTR_SUBASR] = STENCIL_XAS_REG(MODRM_SAR, OP_SUB_RM),
+    [INSTR_XORLSR] = STENCIL_XAS_REG(MODRM_SHR, OP_XOR_RM),
+    [INSTR_ADDLSR] = STENCIL_XAS_REG(MODRM_SHR, OP_ADD_RM),
+    [INSTR_SUBLSR] = STENCIL_XAS_REG(MODRM_SHR, OP_SUB_RM),
 };
 
-static const uint32_t tpl_xas_mem[] = {
-    0x0404334c, /* xor */
-    0x0404034c, /* add */
-    0x04042b4c  /* sub */
+static const stencil stencils_mem[INSTR_BRANCH] = {
+    [INSTR_MULOR] = STENCIL_MUL_MEM(MODRM_OR),
+    [INSTR_MULXOR] = STENCIL_MUL_MEM(MODRM_XOR),
+    [INSTR_MULADD] = STENCIL_MUL_MEM(MODRM_ADD),
+    [INSTR_RMCG] = STENCIL_RMCG,
+    [INSTR_XORROR] = STENCIL_XAS_MEM(MODRM_ROR, OP_XOR_R),
+    [INSTR_ADDROR] = STENCIL_XAS_MEM(MODRM_ROR, OP_ADD_R),
+    [INSTR_SUBROR] = STENCIL_XAS_MEM(MODRM_ROR, OP_SUB_R),
+    [INSTR_XORASR] = STENCIL_XAS_MEM(MODRM_SAR, OP_XOR_R),
+    [INSTR_ADDASR] = STENCIL_XAS_MEM(MODRM_SAR, OP_ADD_R),
+    [INSTR_SUBASR] = STENCIL_XAS_MEM(MODRM_SAR, OP_SUB_R),
+    [INSTR_XORLSR] = STENCIL_XAS_MEM(MODRM_SHR, OP_XOR_R),
+    [INSTR_ADDLSR] = STENCIL_XAS_MEM(MODRM_SHR, OP_ADD_R),
+    [INSTR_SUBLSR] = STENCIL_XAS_MEM(MODRM_SHR, OP_SUB_R),
 };
 
-static inline uint8_t* emit_imul_reg_4c(uint8_t* pos, uint32_t dst, uint32_t src) {
-    uint32_t tpl = 0xc0af0f4c;
-    tpl |= src << 24;
-    tpl |= dst << 27;
-    EMIT(pos, tpl);
-    return pos;
-}
+/* code sizes of the slots */
+#define SIZE_RMCG 16
+#define SIZE_MUL_REG 8
+#define SIZE_XAS_REG 7
+#define SIZE_MUL_MEM 17
+#define SIZE_XAS_MEM 16
 
-static inline uint8_t* emit_imul_reg_4d(uint8_t* pos, uint32_t dst, uint32_t src) {
-    uint32_t tpl = 0xc0af0f4d;
-    tpl |= src << 24;
-    tpl |= dst << 27;
-    EMIT(pos, tpl);
-    return pos;
-}
+/*
+    The emitters copy STENCIL_SIZE bytes, the bytes past the end of the
+    instruction are overwritten by the code that follows.
+*/
 
-static inline uint8_t* emit_imul_mem(uint8_t* pos, uint32_t dst) {
-    EMIT_BYTE(pos, 0x4c);
-    /* imul dst, qword ptr [rsp+rax] */
-    uint32_t tpl = 0x0404af0f;
-    tpl |= dst << 19;
-    EMIT(pos, tpl);
-    return pos;
+static FORCE_INLINE const uint8_t* copy_stencil(uint8_t* pos, const stencil stencils[], const instruction* instr) {
+    const uint8_t* code = stencils[instr->opcode].code;
+    memcpy(pos, code, STENCIL_SIZE);
+    return code;
 }
 
-static inline uint8_t* emit_op_imm(uint8_t* pos, uint32_t tpl, uint32_t dst, uint32_t imm) {
-    tpl |= dst << 16;
-    tpl |= imm << 24;
-    EMIT(pos, tpl);
-    return pos;
+static FORCE_INLINE void emit_rmcg(uint8_t* pos, const stencil stencils[], const instruction* instr) {
+    const uint8_t* code = copy_stencil(pos, stencils, instr);
+    /* R8/R9 are rsi/rdi */
+    pos[8] = code[8] | (instr->dst << 3) | (instr->src & 1);
+    pos[11] = code[11] | instr->dst;
+    pos[12] = instr->imm;
+    pos[15] = code[15] | (instr->dst << 3);
 }
 
-static inline uint8_t* emit_op_reg_4d(uint8_t* pos, uint16_t tpl, uint32_t dst, uint32_t src) {
-    EMIT_BYTE(pos, 0x4d);
-    tpl |= dst << 8;
-    tpl |= src << 11;
-    EMIT(pos, tpl);
-    return pos;
+static FORCE_INLINE void emit_mul_reg(uint8_t* pos, const instruction* instr) {
+    const uint8_t* code = copy_stencil(pos, stencils_reg, instr);
+    pos[2] = code[2] | instr->dst;
+    pos[3] = instr->imm;
+    pos[7] = code[7] | (instr->dst << 3) | instr->src;
 }
 
-static inline uint8_t* emit_op_reg_4c(uint8_t* pos, uint16_t tpl, uint32_t dst, uint32_t src) {
-    EMIT_BYTE(pos, 0x4c);
-    tpl |= dst << 8;
-    tpl |= src << 11;
-    EMIT(pos, tpl);
-    return pos;
+static FORCE_INLINE void emit_xas_reg(uint8_t* pos, const instruction* instr) {
+    const uint8_t* code = copy_stencil(pos, stencils_reg, instr);
+    pos[2] = code[2] | instr->dst;
+    pos[3] = instr->imm;
+    pos[6] = code[6] | (instr->src << 3) | instr->dst;
 }
 
-static inline uint8_t* emit_op_mem(uint8_t* pos, uint32_t tpl, uint32_t dst) {
-    tpl |= dst << 19;
-    EMIT(pos, tpl);
-    return pos;
+static FORCE_INLINE void emit_mul_mem(uint8_t* pos, const instruction* instr) {
+    const uint8_t* code = copy_stencil(pos, stencils_mem, instr);
+    pos[2] = code[2] | (instr->src << 3);
+    pos[5] = code[5] | instr->dst;
+    pos[6] = instr->imm;
+    pos[15] = code[15] | (instr->dst << 3);
 }
 
-static inline uint8_t* emit_jz(uint8_t* pos, uint8_t* targetp2) {
-    uint32_t offset = (uint32_t)(targetp2 - pos);
-    uint16_t isn;
-    if (offset >= (uint32_t)-128) {
-        isn = 0x0074;
-        isn |= offset << 8;
-        EMIT(pos, isn);
-    }
-    else {
-        offset -= 4;
-        isn = 0x840f;
-        EMIT(pos, isn);
-        EMIT(pos, offset);
-    }
-    return pos;
+static FORCE_INLINE void emit_xas_mem(uint8_t* pos, const instruction* instr) {
+    const uint8_t* code = copy_stencil(pos, stencils_mem, instr);
+    pos[2] = code[2] | (instr->src << 3);
+    pos[5] = code[5] | instr->dst;
+    pos[6] = instr->imm;
+    pos[14] = code[14] | (instr->dst << 3);
 }
 
-static uint8_t* compile_program_reg(const hashwx_program * program, uint8_t* pos) {
-    uint8_t* target = NULL;
-    for (int i = 0; i < HASHWX_PROGRAM_SIZE; ++i) {
-        const instruction* instr = &program->code[i];
-        instr_type opcode = instr->opcode;
-        switch (opcode)
-        {
-        case INSTR_MULOR:
-        case INSTR_MULXOR:
-        case INSTR_MULADD:
-        {
-            /* or/xor/add dst, imm */
-            pos = emit_op_imm(pos, tpl_mul[opcode], instr->dst, instr->imm);
-            /* imul dst, src */
-            pos = emit_imul_reg_4d(pos, instr->dst, instr->src);
-            break;
-        }
-        case INSTR_RMCG:
-        {
-            target = pos; /* +2 */
-            EMIT(pos, code_target);
-            /* imul dst, src */
-            pos = emit_imul_reg_4c(pos, instr->dst, instr->src - 2);
-            /* ror dst, imm */
-            pos = emit_op_imm(pos, 0x00c8c149, instr->dst, instr->imm);
-            /* mov rdx, dst */
-            pos = emit_op_reg_4c(pos, 0xc089, 2, instr->dst);
-            break;
-        }
-        case INSTR_XORROR:
-        case INSTR_ADDROR:
-        case INSTR_SUBROR:
-        case INSTR_XORASR:
-        case INSTR_ADDASR:
-        case INSTR_SUBASR:
-        case INSTR_XORLSR:
-        case INSTR_ADDLSR:
-        case INSTR_SUBLSR:
-        {
-            opcode -= 4;
-            /* ror/sar/shr dst, imm */
-            pos = emit_op_imm(pos, tpl_pre_xas[opcode / 3], instr->dst, instr->imm);
-            /* xor/add/sub dst, src */
-            pos = emit_op_reg_4d(pos, tpl_xas_reg[opcode % 3], instr->dst, instr->src);
-            break;
-        }
-        case INSTR_BRANCH:
-        {
-            EMIT(pos, code_branch);
-            /* jz target */
-            pos = emit_jz(pos, target);
-            break;
-        }
-        case INSTR_HALT:
-            break;
-        default:
-            UNREACHABLE;
-        }
+static uint8_t* compile_program_reg(const hashwx_program* program, uint8_t* pos) {
+    /* the jump skips the "test ebp, ebp" of INSTR_RMCG */
+    uint8_t* target = pos; /* +2 */
+    emit_rmcg(pos, stencils_reg, &program->code[0]);
+    pos += SIZE_RMCG;
+    for (int i = 1; i < 7; i += 2) {
+        emit_xas_reg(pos, &program->code[i]);
+        pos += SIZE_XAS_REG;
+        emit_mul_reg(pos, &program->code[i + 1]);
+        pos += SIZE_MUL_REG;
     }
+    /* INSTR_BRANCH */
+    EMIT(pos, code_branch);
+    /* jz target */
+    pos = emit_jz(pos, target);
+    emit_xas_reg(pos, &program->code[8]);
+    pos += SIZE_XAS_REG;
     return pos;
 }
 
 static uint8_t* compile_program_mem(const hashwx_program* program, uint8_t* pos) {
-    uint8_t* target = NULL;
-    for (int i = 0; i < HASHWX_PROGRAM_SIZE; ++i) {
-        const instruction* instr = &program->code[i];
-        instr_type opcode = instr->opcode;
-        switch (opcode)
-        {
-        case INSTR_MULOR:
-        case INSTR_MULXOR:
-        case INSTR_MULADD:
-        {
-            /* mov rax, src */
-            pos = emit_op_reg_4c(pos, 0xc089, 0, instr->src);
-            /* or/xor/add dst, imm */
-            pos = emit_op_imm(pos, tpl_mul[opcode], instr->dst, instr->imm);
-            /* and eax, 2040 */
-            EMIT(pos, code_address);
-            /* imul dst, qword ptr [rsp+rax] */
-            pos = emit_imul_mem(pos, instr->dst);
-            break;
-        }
-        case INSTR_RMCG:
-        {
-            target = pos; /* +2 */
-            EMIT(pos, code_target);
-            /* imul dst, src */
-            pos = emit_imul_reg_4c(pos, instr->dst, instr->src - 2);
-            /* ror dst, imm */
-            pos = emit_op_imm(pos, 0x00c8c149, instr->dst, instr->imm);
-            /* mov rdx, dst */
-            pos = emit_op_reg_4c(pos, 0xc089, 2, instr->dst);
-            break;
-        }
-        case INSTR_XORROR:
-        case INSTR_ADDROR:
-        case INSTR_SUBROR:
-        case INSTR_XORASR:
-        case INSTR_ADDASR:
-        case INSTR_SUBASR:
-        case INSTR_XORLSR:
-        case INSTR_ADDLSR:
-        case INSTR_SUBLSR:
-        {
-            opcode -= 4;
-            /* mov rax, src */
-            pos = emit_op_reg_4c(pos, 0xc089, 0, instr->src);
-            /* ror/sar/shr dst, imm */
-            pos = emit_op_imm(pos, tpl_pre_xas[opcode / 3], instr->dst, instr->imm);
-            /* and eax, 2040 */
-            EMIT(pos, code_address);
-            /* xor/add/sub dst, qword ptr [rsp+rax] */
-            pos = emit_op_mem(pos, tpl_xas_mem[opcode % 3], instr->dst);
-            break;
-        }
-        case INSTR_BRANCH:
-        {
-            EMIT(pos, code_branch);
-            /* jz target */
-            pos = emit_jz(pos, target);
-            break;
-        }
-        case INSTR_HALT:
-            break;
-        default:
-            UNREACHABLE;
-        }
+    uint8_t* target = pos; /* +2 */
+    emit_rmcg(pos, stencils_mem, &program->code[0]);
+    pos += SIZE_RMCG;
+    for (int i = 1; i < 7; i += 2) {
+        emit_xas_mem(pos, &program->code[i]);
+        pos += SIZE_XAS_MEM;
+        emit_mul_mem(pos, &program->code[i + 1]);
+        pos += SIZE_MUL_MEM;
     }
+    /* INSTR_BRANCH */
+    EMIT(pos, code_branch);
+    /* jz target */
+    pos = emit_jz(pos, target);
+    emit_xas_mem(pos, &program->code[8]);
+    pos += SIZE_XAS_MEM;
     return pos;
 }
 
-void hashwx_compile_x86(uint8_t* code, const hashwx_program_list* program_list) {
-    hashwx_vm_rw(code, HASHWX_CODE_SIZE);
+/*
+    The code of every program has a fixed size, so the register phase and
+    the memory phase of a program are compiled at the same time, each at
+    its own position in the code buffer.
+*/
+#define REG_PROGRAM_SIZE 94
+#define MEM_PROGRAM_SIZE 141
+#define BODY_OFFSET (sizeof(code_prologue) + sizeof(code_epilogue))
+#define REG_PHASE_OFFSET (BODY_OFFSET + sizeof(code_body_begin))
+#define MEM_PHASE_OFFSET (REG_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * REG_PROGRAM_SIZE + sizeof(code_clear_bc))
+#define BODY_END_OFFSET (MEM_PHASE_OFFSET + HASHWX_NUM_PROGRAMS * MEM_PROGRAM_SIZE)
+#define LOOP_OFFSET (BODY_END_OFFSET + sizeof(code_body_end))
+#define LOOP_SIZE (sizeof(code_loop_prologue) + sizeof(code_loop_begin) + sizeof(code_loop_end))
+/* end of "jb next" in code_loop_end */
+#define LOOP_JUMP_END 152
+
+static FORCE_INLINE void compile_program(const hashwx_program* program, uint8_t* code, uint32_t index) {
+    uint8_t* reg_code = code + REG_PHASE_OFFSET + index * REG_PROGRAM_SIZE;
+    uint8_t* pos = compile_program_reg(program, reg_code);
+    EMIT(pos, code_store);
+    assert(pos - reg_code == REG_PROGRAM_SIZE);
+    uint8_t* mem_code = code + MEM_PHASE_OFFSET + index * MEM_PROGRAM_SIZE;
+    pos = compile_program_mem(program, mem_code);
+    assert(pos - mem_code == MEM_PROGRAM_SIZE);
+}
+
+/* sets the rel32 operand of the jump or call instruction that ends at pos */
+static void patch_rel32(uint8_t* pos, const uint8_t* target) {
+    uint32_t offset = (uint32_t)(target - pos);
+    memcpy(pos - 4, &offset, sizeof(offset));
+}
+
+static void compile_begin(uint8_t* code) {
     uint8_t* pos = code;
     EMIT(pos, code_prologue);
+    patch_rel32(pos, code + BODY_OFFSET);
+    EMIT(pos, code_epilogue);
+    EMIT(pos, code_body_begin);
+}
 
-    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
-        pos = compile_program_reg(&program_list->prog[i], pos);
-        EMIT(pos, code_store);
-    }
-
+static void compile_end(uint8_t* code) {
+    /* these overwrite the bytes past the last stencil of each phase */
+    uint8_t* pos = code + MEM_PHASE_OFFSET - sizeof(code_clear_bc);
     EMIT(pos, code_clear_bc);
+    pos = code + BODY_END_OFFSET;
+    EMIT(pos, code_body_end);
+    EMIT(pos, code_loop_prologue);
+    uint8_t* next = pos;
+    EMIT(pos, code_loop_begin);
+    patch_rel32(pos, code + BODY_OFFSET);
+    uint8_t* loop_end = pos;
+    EMIT(pos, code_loop_end);
+    assert(loop_end[LOOP_JUMP_END - 6] == 0x0f && loop_end[LOOP_JUMP_END - 5] == 0x82);
+    patch_rel32(loop_end + LOOP_JUMP_END, next);
+    assert(pos - code <= HASHWX_CODE_SIZE);
+}
 
+const hashwx_code_layout hashwx_layout_x86 = {
+    .epilogue = sizeof(code_prologue),
+    .body = BODY_OFFSET,
+    .reg_phase = REG_PHASE_OFFSET,
+    .reg_program_size = REG_PROGRAM_SIZE,
+    .mem_phase = MEM_PHASE_OFFSET,
+    .mem_program_size = MEM_PROGRAM_SIZE,
+    .loop = LOOP_OFFSET,
+    .size = LOOP_OFFSET + LOOP_SIZE,
+};
+
+void hashwx_compile_x86(uint8_t* code, const hashwx_program_list* program_list) {
+    compile_begin(code);
     for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
-        pos = compile_program_mem(&program_list->prog[i], pos);
+        compile_program(&program_list->prog[i], code, i);
     }
+    compile_end(code);
+}
 
-    EMIT(pos, code_epilogue);
-    hashwx_vm_rx(code, HASHWX_CODE_SIZE);
+void hashwx_compile_x86_fused(uint8_t* code, const siphash_key* key) {
+    siphash_rng gen;
+    hashwx_program program;
+    compile_begin(code);
+    hashwx_program_gen_init(key, &gen);
+    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        hashwx_program_generate(&gen, &program);
+        compile_program(&program, code, i);
+    }
+    compile_end(code);
 }
 
 #endif
@@ -4,10 +4,18 @@
 #include "context.h"
 #include "program.h"
 #include "compiler.h"
+#include "code_cache.h"
 
 #include <stdlib.h>
+#include <assert.h>
 
 hashwx_ctx* hashwx_alloc(hashwx_type type) {
+#if !HASHWX_COMPILER || defined(HASHWX_COMPILER_WASM)
+    /* WASM modules are compiled by the host, so there is nothing to tier up to */
+    if (type & HASHWX_AUTO) {
+        type = HASHWX_INTERPRETED;
+    }
+#endif
     if (!HASHWX_COMPILER && (type & HASHWX_COMPILED)) {
         return HASHWX_NOTSUPP;
     }
@@ -16,18 +24,29 @@ hashwx_ctx* hashwx_alloc(hashwx_type type) {
         goto failure;
     }
     ctx->code = NULL;
-    if (type & HASHWX_COMPILED) {
+    ctx->program_list = NULL;
+    ctx->cache_path = NULL;
+    ctx->cache_file = NULL;
+    ctx->nonces = 0;
+    ctx->threshold = HASHWX_JIT_THRESHOLD;
+#ifdef HASHWX_STATS
+    hashwx_stats_register(ctx);
+#endif
+    if (type & (HASHWX_COMPILED | HASHWX_AUTO)) {
+        hashwx_type base = type & HASHWX_AUTO ? HASHWX_AUTO : HASHWX_COMPILED;
+        ctx->type = type & HASHWX_DUAL_MAPPED ? base | HASHWX_DUAL_MAPPED : base;
         if (!hashwx_compiler_init(ctx)) {
             goto failure;
         }
-        ctx->type = HASHWX_COMPILED;
     }
     else {
+        ctx->type = HASHWX_INTERPRETED;
+    }
+    if (!(ctx->type & HASHWX_COMPILED)) {
         ctx->program_list = malloc(sizeof(hashwx_program_list));
         if (ctx->program_list == NULL) {
             goto failure;
         }
-        ctx->type = HASHWX_INTERPRETED;
     }
 #ifndef NDEBUG
     ctx->has_program = false;
@@ -38,16 +57,22 @@ failure:
     return NULL;
 }
 
+void hashwx_set_jit_threshold(hashwx_ctx* ctx, uint64_t nonces) {
+    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+    ctx->threshold = nonces;
+}
+
 void hashwx_free(hashwx_ctx* ctx) {
     if (ctx != NULL && ctx != HASHWX_NOTSUPP) {
         if (ctx->code != NULL) {
-            if (ctx->type & HASHWX_COMPILED) {
-                hashwx_compiler_destroy(ctx);
-            }
-            else {
-                free(ctx->program_list);
-            }
+            hashwx_code_cache_release(ctx);
+            hashwx_compiler_destroy(ctx);
         }
+#ifdef HASHWX_STATS
+        hashwx_stats_unregister(ctx);
+#endif
+        free(ctx->cache_path);
+        free(ctx->program_list);
         free(ctx);
     }
 }
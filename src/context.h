@@ -9,22 +9,38 @@
 #include "hashwx.h"
 #include "siphash_rng.h"
 #include "program.h"
+#include "stats.h"
 
 typedef void program_func(uint64_t r[]);
 
 typedef struct hashwx_program_list hashwx_program_list;
 
 typedef struct hashwx_ctx {
+    uint8_t* code;
+    hashwx_program_list* program_list;
     union {
-        uint8_t* code;
+        uint8_t* code_exec;
         program_func* func;
-        hashwx_program_list* program_list;
     };
+    /* executable view of code, code_exec can point into a cached file instead */
+    uint8_t* exec_view;
+    /* see code_cache.c */
+    char* cache_path;
+    const uint8_t* cache_file;
     hashwx_type type;
     siphash_key key;
+    /* HASHWX_AUTO: nonces hashed since hashwx_make */
+    uint64_t nonces;
+    uint64_t threshold;
 #ifndef NDEBUG
     bool has_program;
 #endif
+#ifdef HASHWX_STATS
+    stats_counters stats;
+    /* list of live instances, see stats.c */
+    struct hashwx_ctx* stats_prev;
+    struct hashwx_ctx* stats_next;
+#endif
 #ifdef __wasm__
     uint8_t seed[HASHWX_SEED_SIZE];
     uint64_t reg[HASHWX_REG_SIZE];
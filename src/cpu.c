@@ -0,0 +1,133 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+#ifdef HASHWX_CPU_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef HASHWX_THREADS
+#include <threads.h>
+static once_flag features_once = ONCE_FLAG_INIT;
+#else
+static bool features_done = false;
+#endif
+
+static uint32_t features = 0;
+
+#ifdef HASHWX_CPU_X86
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+    __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* features that can be disabled with the environment variable HASHWX_CPU_DISABLE */
+static const struct {
+    const char* name;
+    uint32_t feature;
+} feature_names[] = {
+    { "ssse3", HASHWX_CPU_SSSE3 },
+    { "sse41", HASHWX_CPU_SSE41 },
+    { "sha", HASHWX_CPU_SHA },
+    { "avx2", HASHWX_CPU_AVX2 },
+    { "avx512", HASHWX_CPU_AVX512 },
+};
+
+/* features named in HASHWX_CPU_DISABLE, e.g. "avx512,avx2" */
+static uint32_t disabled_features(void) {
+#ifdef _MSC_VER
+#pragma warning(suppress: 4996)
+#endif
+    const char* env = getenv("HASHWX_CPU_DISABLE");
+    uint32_t disabled = 0;
+    if (env == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(feature_names) / sizeof(feature_names[0]); ++i) {
+        if (strstr(env, feature_names[i].name) != NULL) {
+            disabled |= feature_names[i].feature;
+        }
+    }
+    return disabled;
+}
+
+/* state components enabled by the OS in XCR0 */
+static uint64_t xgetbv(void) {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+#endif
+
+static void detect_cpu(void) {
+#ifdef HASHWX_CPU_X86
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    uint32_t max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return;
+    }
+    cpuid(1, 0, regs);
+    if (regs[2] & (1 << 9)) {
+        features |= HASHWX_CPU_SSSE3;
+    }
+    if (regs[2] & (1 << 19)) {
+        features |= HASHWX_CPU_SSE41;
+    }
+    /* AVX state must be enabled by the OS (OSXSAVE) */
+    uint64_t xcr0 = 0;
+    if (regs[2] & (1 << 27)) {
+        xcr0 = xgetbv();
+    }
+    if (max_leaf < 7) {
+        return;
+    }
+    cpuid(7, 0, regs);
+    if (regs[1] & (1 << 29)) {
+        features |= HASHWX_CPU_SHA;
+    }
+    /* XMM and YMM state */
+    if ((xcr0 & 0x06) == 0x06 && (regs[1] & (1 << 5))) {
+        features |= HASHWX_CPU_AVX2;
+    }
+    /* XMM, YMM, opmask and ZMM state, AVX512F and AVX512DQ */
+    if ((xcr0 & 0xe6) == 0xe6 && (regs[1] & (1 << 16)) && (regs[1] & (1 << 17))) {
+        features |= HASHWX_CPU_AVX512;
+    }
+#endif
+}
+
+static void detect_features(void) {
+    detect_cpu();
+#ifdef HASHWX_CPU_X86
+    features &= ~disabled_features();
+#endif
+}
+
+uint32_t hashwx_cpu_features(void) {
+#ifdef HASHWX_THREADS
+    call_once(&features_once, &detect_features);
+#else
+    if (!features_done) {
+        detect_features();
+        features_done = true;
+    }
+#endif
+    return features;
+}
@@ -0,0 +1,32 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+#include <hashwx.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define HASHWX_CPU_X86
+#endif
+
+/* CPU features that are detected at run time */
+#define HASHWX_CPU_SSSE3 (1 << 0)
+#define HASHWX_CPU_SSE41 (1 << 1)
+#define HASHWX_CPU_SHA   (1 << 2)
+#define HASHWX_CPU_AVX2  (1 << 3)
+/* AVX-512 Foundation and Doubleword/Quadword instructions */
+#define HASHWX_CPU_AVX512 (1 << 4)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HASHWX_PRIVATE uint32_t hashwx_cpu_features(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
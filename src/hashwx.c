@@ -9,48 +9,138 @@
 #include "siphash_rng.h"
 #include "context.h"
 #include "compiler.h"
+#include "code_cache.h"
+#include "siphash_simd.h"
+#include "stats.h"
 
-static void initialize_program(hashwx_ctx* ctx, hashwx_program_list* program_list,
-    siphash_key keys[2]) {
-    hashwx_program_list_generate(&keys[0], program_list);
-    ctx->key = keys[1];
+static void initialize_key(hashwx_ctx* ctx, const siphash_key* key) {
+    ctx->key = *key;
 #ifndef NDEBUG
     ctx->has_program = true;
 #endif
 }
 
-void hashwx_make(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE]) {
-    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
-    assert(seed != NULL);
-    siphash_key keys[2];
+static FORCE_INLINE void load_keys(const uint8_t seed[HASHWX_SEED_SIZE], siphash_key keys[2]) {
     keys[0].k0 = platform_load64(&seed[0]);
     keys[0].k1 = platform_load64(&seed[8]);
     keys[1].k0 = platform_load64(&seed[16]);
     keys[1].k1 = platform_load64(&seed[24]);
+}
+
+void hashwx_make(hashwx_ctx* ctx, const uint8_t seed[HASHWX_SEED_SIZE]) {
+    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+    assert(seed != NULL);
+    STATS_CLOCK(start);
+    siphash_key keys[2];
+    load_keys(seed, keys);
+    if (ctx->type & HASHWX_AUTO) {
+        /* interpreted until the JIT threshold is reached */
+        ctx->type &= ~HASHWX_COMPILED;
+        ctx->nonces = 0;
+        hashwx_program_list_generate(&keys[0], ctx->program_list);
+    }
+    else if (ctx->type & HASHWX_COMPILED) {
+        if (ctx->cache_path == NULL || !hashwx_code_cache_load(ctx, seed)) {
+            /* the cache can be disabled while a file is mapped */
+            hashwx_code_cache_release(ctx);
+            /* each program is compiled right after it's generated */
+            hashwx_compiler_make_fused(ctx, &keys[0]);
+            if (ctx->cache_path != NULL) {
+                hashwx_code_cache_store(ctx, seed);
+            }
+        }
+    }
+    else {
+        hashwx_program_list_generate(&keys[0], ctx->program_list);
+    }
+    initialize_key(ctx, &keys[1]);
+    STATS_ADD(&ctx->stats, makes, 1);
+    if (ctx->type & HASHWX_COMPILED) {
+        STATS_TIME(&ctx->stats, compile_ns, start);
+    }
+    else {
+        STATS_TIME(&ctx->stats, generate_ns, start);
+    }
+}
+
+int hashwx_import_program(hashwx_ctx* ctx, const uint8_t data[HASHWX_EXPORT_SIZE]) {
+    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+    assert(data != NULL);
+    STATS_CLOCK(start);
+    hashwx_program_list program_list;
+    siphash_key key;
+#ifndef NDEBUG
+    ctx->has_program = false;
+#endif
+    if (!hashwx_program_list_import(data, &program_list, &key)) {
+        return 0;
+    }
+    if (ctx->type & HASHWX_AUTO) {
+        ctx->type &= ~HASHWX_COMPILED;
+        ctx->nonces = 0;
+        *ctx->program_list = program_list;
+    }
+    else if (ctx->type & HASHWX_COMPILED) {
+        hashwx_code_cache_release(ctx);
+        hashwx_compiler_make(ctx, &program_list);
+    }
+    else {
+        *ctx->program_list = program_list;
+    }
+    initialize_key(ctx, &key);
+    STATS_ADD(&ctx->stats, makes, 1);
     if (ctx->type & HASHWX_COMPILED) {
-        hashwx_program_list program_list;
-        initialize_program(ctx, &program_list, keys);
-        hashwx_compile(ctx->code, &program_list);
+        STATS_TIME(&ctx->stats, compile_ns, start);
     }
     else {
-        initialize_program(ctx, ctx->program_list, keys);
+        STATS_TIME(&ctx->stats, generate_ns, start);
+    }
+    return 1;
+}
+
+void hashwx_export_program(const uint8_t seed[HASHWX_SEED_SIZE], uint8_t out[HASHWX_EXPORT_SIZE]) {
+    assert(seed != NULL);
+    assert(out != NULL);
+    siphash_key keys[2];
+    hashwx_program_list program_list;
+    load_keys(seed, keys);
+    hashwx_program_list_generate(&keys[0], &program_list);
+    hashwx_program_list_export(&program_list, &keys[1], out);
+}
+
+static NEVER_INLINE void tier_up(hashwx_ctx* ctx) {
+    STATS_CLOCK(start);
+    hashwx_compiler_make(ctx, ctx->program_list);
+    ctx->type |= HASHWX_COMPILED;
+    STATS_TIME(&ctx->stats, compile_ns, start);
+}
+
+/*
+    Counts the nonces hashed by a HASHWX_AUTO instance and compiles its
+    function before the call that takes it past the JIT threshold. This
+    is the only place where a const instance is modified, which is why
+    HASHWX_AUTO instances can't be shared between threads.
+*/
+static FORCE_INLINE void count_nonces(const hashwx_ctx* ctx, size_t count) {
+    if ((ctx->type & (HASHWX_AUTO | HASHWX_COMPILED)) == HASHWX_AUTO) {
+        hashwx_ctx* tiered = (hashwx_ctx*)ctx;
+        if (tiered->nonces > tiered->threshold || count > tiered->threshold - tiered->nonces) {
+            tier_up(tiered);
+        }
+        else {
+            tiered->nonces += count;
+        }
     }
 }
 
 uint64_t hashwx_exec(const hashwx_ctx* ctx, uint64_t input) {
     assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
     assert(ctx->has_program);
+    STATS_CLOCK(start);
     uint64_t r[HASHWX_REG_SIZE];
+    count_nonces(ctx, 1);
     //init registers
-    siphash_rng gen;
-    hashwx_rng_init(&gen, &ctx->key, input);
-    for (uint64_t i = 0; i < 8; ++i) {
-        r[i] = hashwx_rng_next(&gen);
-    }
-    //adjust R8 to be 3 mod 8
-    r[8] = (r[4] & -8) | 3;
-    //adjust R9 to be 5 mod 8
-    r[9] = (r[7] & -8) | 5;
+    init_registers(&ctx->key, input, r);
     //execute
 #ifndef HASHWX_COMPILER_WASM
     if (ctx->type & HASHWX_COMPILED) {
@@ -59,12 +149,275 @@ uint64_t hashwx_exec(const hashwx_ctx* ctx, uint64_t input) {
     else
 #endif
     {
-        hashwx_program_list_execute(ctx->program_list, r);
+        STATS_BRANCHES(CTX_STATS(ctx), hashwx_program_list_execute(ctx->program_list, r));
     }
     //finalize
-    SIPROUND(r[0], r[1], r[2], r[3]);
-    SIPROUND(r[4], r[5], r[6], r[7]);
-    return r[3] ^ r[7] ^ r[9];
+    uint64_t hash = finalize_registers(r);
+    STATS_ADD(CTX_STATS(ctx), hashes, 1);
+    STATS_TIME(CTX_STATS(ctx), exec_ns, start);
+    return hash;
+}
+
+#ifdef HASHWX_COMPILER_LOOP
+
+/* Hashes nonces in the nonce loop of the compiled code, see hashwx_loop_args */
+static FORCE_INLINE void exec_loop(const hashwx_ctx* ctx, const uint64_t* inputs, uint64_t first,
+    size_t count, uint64_t* out, uint64_t target, hashwx_loop_args* args) {
+    const siphash_key key = ctx->key;
+    args->init[0] = SIPHASH_C0 ^ key.k0;
+    args->init[1] = SIPHASH_C1 ^ key.k1;
+    args->init[2] = SIPHASH_C2 ^ key.k0;
+    args->init[3] = SIPHASH_C3 ^ key.k1;
+    args->k0 = key.k0;
+    args->k1 = key.k1;
+    args->first = first;
+    args->inputs = inputs;
+    args->out = out;
+    args->target = target;
+    args->count = count;
+    args->index = 0;
+    union {
+        uint8_t* code;
+        hashwx_loop_func* func;
+    } loop = { ctx->code_exec + hashwx_layout.loop };
+    loop.func(args);
+}
+
+#endif
+
+/* SIMD code paths for groups of HASHWX_MAX_LANES inputs */
+typedef struct batch_engine {
+    int sip_lanes;
+    siphash_init_func* sip_init;
+    siphash_final_func* sip_final;
+    int prog_lanes;
+    program_list_simd_func* prog_simd;
+} batch_engine;
+
+static bool select_batch_engine(const hashwx_ctx* ctx, batch_engine* engine) {
+    engine->sip_lanes = hashwx_siphash_simd(&engine->sip_init, &engine->sip_final);
+    engine->prog_simd = NULL;
+    engine->prog_lanes = 1;
+    if (!(ctx->type & HASHWX_COMPILED)) {
+        engine->prog_simd = hashwx_program_list_simd(&engine->prog_lanes);
+    }
+    return engine->sip_lanes > 0 || engine->prog_simd != NULL;
+}
+
+static FORCE_INLINE void exec_group(const hashwx_ctx* ctx, const batch_engine* engine,
+    const uint64_t input[HASHWX_MAX_LANES], uint64_t out[HASHWX_MAX_LANES]) {
+    uint64_t r[HASHWX_MAX_LANES][HASHWX_REG_SIZE];
+    //init registers
+    if (engine->sip_lanes > 0) {
+        for (int i = 0; i < HASHWX_MAX_LANES; i += engine->sip_lanes) {
+            engine->sip_init(&ctx->key, &input[i], &r[i]);
+        }
+    }
+    else {
+        for (int i = 0; i < HASHWX_MAX_LANES; ++i) {
+            init_registers(&ctx->key, input[i], r[i]);
+        }
+    }
+    //execute
+#ifndef HASHWX_COMPILER_WASM
+    if (ctx->type & HASHWX_COMPILED) {
+        for (int i = 0; i < HASHWX_MAX_LANES; ++i) {
+            ctx->func(r[i]);
+        }
+    }
+    else
+#endif
+    if (engine->prog_simd != NULL) {
+        for (int i = 0; i < HASHWX_MAX_LANES; i += engine->prog_lanes) {
+            engine->prog_simd(ctx->program_list, &r[i]);
+        }
+    }
+    else {
+        for (int i = 0; i < HASHWX_MAX_LANES; ++i) {
+            hashwx_program_list_execute(ctx->program_list, r[i]);
+        }
+    }
+    //finalize
+    if (engine->sip_lanes > 0) {
+        for (int i = 0; i < HASHWX_MAX_LANES; i += engine->sip_lanes) {
+            engine->sip_final(&r[i], &out[i]);
+        }
+    }
+    else {
+        for (int i = 0; i < HASHWX_MAX_LANES; ++i) {
+            out[i] = finalize_registers(r[i]);
+        }
+    }
+}
+
+/*
+    Hashes either the nonces first, first+1, ..., first+count-1 (inputs == NULL)
+    or the nonces inputs[0..count-1]. Full groups of HASHWX_MAX_LANES nonces
+    use the SIMD code paths. For the rest, the type dispatch is hoisted out of
+    the loop, so each backend runs its own tight loop with the key and the
+    entry point kept in registers.
+*/
+static FORCE_INLINE void exec_batch(const hashwx_ctx* ctx, const uint64_t* inputs,
+    uint64_t first, size_t count, uint64_t* out) {
+    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+    assert(ctx->has_program);
+    assert(out != NULL || count == 0);
+    count_nonces(ctx, count);
+#ifdef HASHWX_COMPILER_LOOP
+    if ((ctx->type & HASHWX_COMPILED) && count > 0) {
+        hashwx_loop_args args;
+        /* no hash is below 0 */
+        exec_loop(ctx, inputs, first, count, out, 0, &args);
+        return;
+    }
+#endif
+    const siphash_key key = ctx->key;
+    uint64_t r[HASHWX_REG_SIZE];
+    size_t i = 0;
+    batch_engine engine;
+    if (count >= HASHWX_MAX_LANES && select_batch_engine(ctx, &engine)) {
+        uint64_t group[HASHWX_MAX_LANES];
+        for (; count - i >= HASHWX_MAX_LANES; i += HASHWX_MAX_LANES) {
+            for (int j = 0; j < HASHWX_MAX_LANES; ++j) {
+                group[j] = inputs != NULL ? inputs[i + j] : first + i + j;
+            }
+            exec_group(ctx, &engine, group, &out[i]);
+        }
+    }
+#ifndef HASHWX_COMPILER_WASM
+    if (ctx->type & HASHWX_COMPILED) {
+        program_func* const func = ctx->func;
+        for (; i < count; ++i) {
+            init_registers(&key, inputs != NULL ? inputs[i] : first + i, r);
+            func(r);
+            out[i] = finalize_registers(r);
+        }
+        return;
+    }
+#endif
+    const hashwx_program_list* const program_list = ctx->program_list;
+    for (; i < count; ++i) {
+        init_registers(&key, inputs != NULL ? inputs[i] : first + i, r);
+        STATS_BRANCHES(CTX_STATS(ctx), hashwx_program_list_execute(program_list, r));
+        out[i] = finalize_registers(r);
+    }
+}
+
+void hashwx_exec_batch(const hashwx_ctx* ctx, uint64_t first_nonce, size_t count, uint64_t* out) {
+    STATS_CLOCK(start);
+    exec_batch(ctx, NULL, first_nonce, count, out);
+    STATS_ADD(CTX_STATS(ctx), hashes, count);
+    STATS_TIME(CTX_STATS(ctx), exec_ns, start);
+}
+
+void hashwx_exec_array(const hashwx_ctx* ctx, const uint64_t* nonces, size_t count, uint64_t* out) {
+    assert(nonces != NULL || count == 0);
+    STATS_CLOCK(start);
+    exec_batch(ctx, nonces, 0, count, out);
+    STATS_ADD(CTX_STATS(ctx), hashes, count);
+    STATS_TIME(CTX_STATS(ctx), exec_ns, start);
+}
+
+static FORCE_INLINE int search(const hashwx_ctx* ctx, uint64_t start_nonce, size_t count,
+    uint64_t target, uint64_t* found_nonce, uint64_t* found_hash) {
+    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+    assert(ctx->has_program);
+    count_nonces(ctx, count);
+    const siphash_key key = ctx->key;
+    uint64_t r[HASHWX_REG_SIZE];
+    uint64_t nonce = start_nonce;
+    uint64_t hash;
+    size_t i = 0;
+#ifdef HASHWX_COMPILER_LOOP
+    if ((ctx->type & HASHWX_COMPILED) && count > 0) {
+        hashwx_loop_args args;
+        exec_loop(ctx, NULL, start_nonce, count, NULL, target, &args);
+        if (args.index == count) {
+            return 0;
+        }
+        nonce = start_nonce + args.index;
+        hash = args.hash;
+        goto found;
+    }
+#endif
+    batch_engine engine;
+    if (count >= HASHWX_MAX_LANES && select_batch_engine(ctx, &engine)) {
+        uint64_t group[HASHWX_MAX_LANES], hashes[HASHWX_MAX_LANES];
+        for (; count - i >= HASHWX_MAX_LANES; i += HASHWX_MAX_LANES) {
+            for (int j = 0; j < HASHWX_MAX_LANES; ++j) {
+                group[j] = nonce + j;
+            }
+            exec_group(ctx, &engine, group, hashes);
+            for (int j = 0; j < HASHWX_MAX_LANES; ++j, ++nonce) {
+                hash = hashes[j];
+                if (hash < target) {
+                    goto found;
+                }
+            }
+        }
+    }
+#ifndef HASHWX_COMPILER_WASM
+    if (ctx->type & HASHWX_COMPILED) {
+        program_func* const func = ctx->func;
+        for (; i < count; ++i, ++nonce) {
+            init_registers(&key, nonce, r);
+            func(r);
+            hash = finalize_registers(r);
+            if (hash < target) {
+                goto found;
+            }
+        }
+        return 0;
+    }
+#endif
+    const hashwx_program_list* const program_list = ctx->program_list;
+    for (; i < count; ++i, ++nonce) {
+        init_registers(&key, nonce, r);
+        STATS_BRANCHES(CTX_STATS(ctx), hashwx_program_list_execute(program_list, r));
+        hash = finalize_registers(r);
+        if (hash < target) {
+            goto found;
+        }
+    }
+    return 0;
+found:
+    *found_nonce = nonce;
+    if (found_hash != NULL) {
+        *found_hash = hash;
+    }
+    return 1;
+}
+
+int hashwx_search(const hashwx_ctx* ctx, uint64_t start_nonce, size_t count,
+    uint64_t target, uint64_t* found_nonce, uint64_t* found_hash) {
+    STATS_CLOCK(start);
+    uint64_t nonce;
+    int found = search(ctx, start_nonce, count, target, &nonce, found_hash);
+    STATS_ADD(CTX_STATS(ctx), hashes, found ? nonce - start_nonce + 1 : count);
+    STATS_TIME(CTX_STATS(ctx), exec_ns, start);
+    if (found && found_nonce != NULL) {
+        *found_nonce = nonce;
+    }
+    return found;
+}
+
+uint64_t hashwx_verify(const uint8_t seed[HASHWX_SEED_SIZE], uint64_t nonce) {
+    assert(seed != NULL);
+    siphash_key keys[2];
+    hashwx_program_list program_list;
+    uint64_t r[HASHWX_REG_SIZE];
+    STATS_LOCAL(local);
+    STATS_CLOCK(start);
+    load_keys(seed, keys);
+    hashwx_program_list_generate(&keys[0], &program_list);
+    STATS_CLOCK(generated);
+    init_registers(&keys[1], nonce, r);
+    STATS_BRANCHES(local, hashwx_program_list_execute(&program_list, r));
+    uint64_t hash = finalize_registers(r);
+    STATS_ADD(local, generate_ns, generated - start);
+    STATS_ADD(local, hashes, 1);
+    STATS_TIME(local, exec_ns, generated);
+    return hash;
 }
 
 #ifdef HASHWX_COMPILER_WASM
@@ -96,16 +449,7 @@ void hashwx_exec_begin(hashwx_ctx* ctx, uint64_t input) {
     assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
     assert(ctx->has_program);
     //init registers
-    siphash_rng gen;
-    hashwx_rng_init(&gen, &ctx->key, input);
-    uint64_t* r = ctx->reg;
-    for (uint64_t i = 0; i < 8; ++i) {
-        r[i] = hashwx_rng_next(&gen);
-    }
-    //adjust R8 to be 3 mod 8
-    r[8] = (r[4] & -8) | 3;
-    //adjust R9 to be 5 mod 8
-    r[9] = (r[7] & -8) | 5;
+    init_registers(&ctx->key, input, ctx->reg);
 }
 
 uint64_t hashwx_exec_final(const hashwx_ctx* ctx) {
@@ -125,4 +469,17 @@ uint64_t hashwx_exec_final(const hashwx_ctx* ctx) {
     return r3 ^ r7 ^ r9;
 }
 
+#define WASM_BUFFER_SIZE 2048
+
+/* Buffer for passing seeds, nonces and hashes between JS and WASM */
+static uint64_t wasm_buffer[WASM_BUFFER_SIZE];
+
+uint64_t* hashwx_buffer(void) {
+    return wasm_buffer;
+}
+
+uint32_t hashwx_buffer_size(void) {
+    return WASM_BUFFER_SIZE;
+}
+
 #endif
@@ -5,6 +5,7 @@
 #define INSTRUCTION_H
 
 #include <stdint.h>
+#include <assert.h>
 
 typedef enum instr_type {
     INSTR_MULOR,    /* or and multiply */
@@ -24,11 +25,18 @@ typedef enum instr_type {
     INSTR_HALT,     /* halt */
 } instr_type;
 
+/*
+    Packed encoding: opcode < 16, registers < 10, immediates <= 65.
+    A program list takes 1280 bytes, so the interpreters can keep the
+    whole function in L1.
+*/
 typedef struct instruction {
-    instr_type opcode;
-    uint32_t src;
-    uint32_t dst;
-    uint32_t imm;
+    uint8_t opcode; /* instr_type */
+    uint8_t src;
+    uint8_t dst;
+    uint8_t imm;
 } instruction;
 
+static_assert(sizeof(instruction) == 4, "instruction must be packed into 4 bytes");
+
 #endif
@@ -0,0 +1,278 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+/*
+    Open-loop load generator that models a verification server. Each thread
+    receives requests with exponentially distributed inter-arrival times
+    (a Poisson process), independently of how fast the previous requests
+    were handled. The latency of a request is measured from its scheduled
+    arrival time, so it includes the time it spent waiting behind slower
+    requests. Scenarios:
+
+    cold     every request has a new seed and hashes 1 nonce
+    repeat   seeds are drawn from a small pool and hashed with hashwx_cache
+    window   every request has a new seed and hashes a solver window of
+             HASHWX_PUZZLE_ATTEMPTS nonces
+*/
+
+#include "test_utils.h"
+#include "platform.h"
+#include "siphash_rng.h"
+
+#include <hashwx.h>
+#include <math.h>
+#include <inttypes.h>
+#if defined(HASHWX_THREADS)
+#include <threads.h>
+#else
+typedef int thrd_t;
+#endif
+
+/* upper bound of the memory of a cached function (see hashwx_cache_alloc),
+   so the cache of the repeat scenario holds the whole seed pool */
+#define CACHE_FUNCTION_MEMORY (12288 + 3072)
+
+typedef enum scenario_id {
+    SCENARIO_COLD,
+    SCENARIO_REPEAT,
+    SCENARIO_WINDOW,
+    SCENARIO_COUNT
+} scenario_id;
+
+static const char* scenario_names[SCENARIO_COUNT] = {
+    [SCENARIO_COLD] = "cold",
+    [SCENARIO_REPEAT] = "repeat",
+    [SCENARIO_WINDOW] = "window",
+};
+
+typedef struct load_job {
+    int id;
+    thrd_t thread;
+    scenario_id scenario;
+    hashwx_ctx* ctx;
+    hashwx_cache* cache;
+    int pool_size;
+    double rate;
+    uint64_t start_time;
+    uint64_t end_time;
+    size_t requests;
+    uint64_t* latencies;
+    uint64_t hash_sum;
+} load_job;
+
+static const siphash_key load_key = {
+    .k0 = 0x6c6f616467656e20,
+    .k1 = 0x6861736877782121
+};
+
+static void wait_until(uint64_t time) {
+    uint64_t now;
+    while ((now = platform_monotonic_ns()) < time) {
+#if defined(HASHWX_THREADS)
+        /* sleep through long gaps, spin through short ones */
+        if (time - now > 1000000) {
+            uint64_t sleep = time - now - 500000;
+            struct timespec duration = { (time_t)(sleep / 1000000000), (long)(sleep % 1000000000) };
+            thrd_sleep(&duration, NULL);
+        }
+#endif
+    }
+}
+
+static void make_seed(siphash_rng* gen, uint8_t seed[HASHWX_SEED_SIZE]) {
+    for (int i = 0; i < HASHWX_SEED_SIZE; i += 8) {
+        uint64_t word = hashwx_rng_next(gen);
+        memcpy(&seed[i], &word, sizeof(word));
+    }
+}
+
+static int worker(void* args) {
+    load_job* job = (load_job*)args;
+    siphash_rng gen;
+    hashwx_rng_init(&gen, &load_key, job->id);
+    uint64_t arrival = job->start_time;
+    uint64_t window[HASHWX_PUZZLE_ATTEMPTS];
+    job->hash_sum = 0;
+    for (size_t i = 0; i < job->requests; ++i) {
+        /* uniform in (0, 1] */
+        double u = ((hashwx_rng_next(&gen) >> 11) + 1) / 9007199254740992.0;
+        arrival += (uint64_t)(-log(u) / job->rate * 1.0e9);
+        uint8_t seed[HASHWX_SEED_SIZE];
+        uint64_t nonce = hashwx_rng_next(&gen);
+        if (job->scenario == SCENARIO_REPEAT) {
+            /* the pool seeds are the first outputs of a common generator */
+            siphash_rng pool;
+            hashwx_rng_init(&pool, &load_key, UINT64_MAX - hashwx_rng_next(&gen) % (uint64_t)job->pool_size);
+            make_seed(&pool, seed);
+        }
+        else {
+            make_seed(&gen, seed);
+        }
+        wait_until(arrival);
+        switch (job->scenario) {
+        case SCENARIO_COLD:
+            hashwx_make(job->ctx, seed);
+            job->hash_sum ^= hashwx_exec(job->ctx, nonce);
+            break;
+        case SCENARIO_REPEAT:
+            job->hash_sum ^= hashwx_cache_exec(job->cache, seed, nonce);
+            break;
+        default:
+            hashwx_make(job->ctx, seed);
+            hashwx_exec_batch(job->ctx, nonce, HASHWX_PUZZLE_ATTEMPTS, window);
+            job->hash_sum ^= window[HASHWX_PUZZLE_ATTEMPTS - 1];
+            break;
+        }
+        uint64_t done = platform_monotonic_ns();
+        job->latencies[i] = done - arrival;
+        job->end_time = done;
+    }
+    return 0;
+}
+
+static bool run_load(hashwx_type type, scenario_id scenario, int threads, double rate,
+    double duration, int pool_size, load_job* jobs, uint64_t* latencies) {
+    size_t requests = (size_t)(rate * duration / threads);
+    if (requests == 0) {
+        requests = 1;
+    }
+    hashwx_cache* cache = NULL;
+    if (scenario == SCENARIO_REPEAT) {
+        cache = hashwx_cache_alloc(type, (size_t)pool_size * CACHE_FUNCTION_MEMORY);
+        if (cache == NULL) {
+            return false;
+        }
+    }
+    bool ok = true;
+    for (int thd = 0; thd < threads; ++thd) {
+        load_job* job = &jobs[thd];
+        job->id = thd;
+        job->scenario = scenario;
+        job->cache = cache;
+        job->ctx = NULL;
+        if (ok && scenario != SCENARIO_REPEAT) {
+            job->ctx = hashwx_alloc(type);
+            ok = job->ctx != NULL && job->ctx != HASHWX_NOTSUPP;
+        }
+        job->pool_size = pool_size;
+        job->rate = rate / threads;
+        job->requests = requests;
+        job->latencies = &latencies[thd * requests];
+    }
+    if (!ok) {
+        for (int thd = 0; thd < threads; ++thd) {
+            if (jobs[thd].ctx != HASHWX_NOTSUPP) {
+                hashwx_free(jobs[thd].ctx);
+            }
+        }
+        hashwx_cache_free(cache);
+        return false;
+    }
+    /* leave time to start the threads before the first arrival */
+    uint64_t start_time = platform_monotonic_ns() + 20000000;
+    for (int thd = 0; thd < threads; ++thd) {
+        jobs[thd].start_time = start_time;
+    }
+    if (threads > 1) {
+#if defined(HASHWX_THREADS)
+        for (int thd = 0; thd < threads; ++thd) {
+            if (thrd_create(&jobs[thd].thread, &worker, &jobs[thd]) != thrd_success) {
+                printf("Error: thread_create failed\n");
+                exit(1);
+            }
+        }
+        for (int thd = 0; thd < threads; ++thd) {
+            thrd_join(jobs[thd].thread, NULL);
+        }
+#endif
+    }
+    else {
+        worker(jobs);
+    }
+    uint64_t end_time = start_time;
+    for (int thd = 0; thd < threads; ++thd) {
+        if (jobs[thd].end_time > end_time) {
+            end_time = jobs[thd].end_time;
+        }
+        hashwx_free(jobs[thd].ctx);
+    }
+    hashwx_cache_free(cache);
+    size_t total = requests * threads;
+    qsort(latencies, total, sizeof(uint64_t), &compare_u64);
+    double elapsed = (end_time - start_time) * 1.0e-9;
+    printf("%-12s %-7s %10.0f %10.0f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+        type == HASHWX_INTERPRETED ? "interpreted" : "compiled",
+        scenario_names[scenario],
+        rate,
+        total / elapsed,
+        percentile(latencies, total, 500) * 1.0e-3,
+        percentile(latencies, total, 900) * 1.0e-3,
+        percentile(latencies, total, 990) * 1.0e-3,
+        percentile(latencies, total, 999) * 1.0e-3,
+        latencies[total - 1] * 1.0e-3);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int rate, duration_ms, threads, pool_size;
+    bool interpret, compiled;
+    const char* scenario_name = "all";
+    read_int_option("--rate", argc, argv, &rate, 10000);
+    read_int_option("--duration", argc, argv, &duration_ms, 2000);
+    read_int_option("--threads", argc, argv, &threads, 1);
+    read_int_option("--seeds", argc, argv, &pool_size, 64);
+    read_option("--interpret", argc, argv, &interpret);
+    read_option("--compiled", argc, argv, &compiled);
+    for (int i = 0; i < argc - 1; ++i) {
+        if (strcmp(argv[i], "--scenario") == 0) {
+            scenario_name = argv[i + 1];
+        }
+    }
+#if !defined(HASHWX_THREADS)
+    if (threads > 1) {
+        printf("Error: Your compiler doesn't support C11 threads.\n");
+        return 1;
+    }
+#endif
+    int first = 0, last = SCENARIO_COUNT - 1;
+    if (strcmp(scenario_name, "all") != 0) {
+        for (first = 0; first < SCENARIO_COUNT; ++first) {
+            if (strcmp(scenario_name, scenario_names[first]) == 0) {
+                break;
+            }
+        }
+        if (first == SCENARIO_COUNT) {
+            printf("Error: unknown scenario '%s'\n", scenario_name);
+            return 1;
+        }
+        last = first;
+    }
+    if (!interpret && !compiled) {
+        interpret = compiled = true;
+    }
+    double duration = duration_ms * 1.0e-3;
+    size_t requests = (size_t)((double)rate * duration / threads) + 1;
+    load_job* jobs = malloc(sizeof(load_job) * threads);
+    uint64_t* latencies = malloc(sizeof(uint64_t) * requests * threads);
+    if (jobs == NULL || latencies == NULL) {
+        printf("Error: memory allocation failure\n");
+        return 1;
+    }
+    printf("Threads: %i, duration: %i ms, repeated seeds: %i\n", threads, duration_ms, pool_size);
+    printf("%-12s %-7s %10s %10s %9s %9s %9s %9s %9s\n", "type", "scenario", "target/s",
+        "achieved/s", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+    for (int s = first; s <= last; ++s) {
+        for (int c = 0; c < 2; ++c) {
+            if (!(c == 0 ? interpret : compiled)) {
+                continue;
+            }
+            hashwx_type type = c == 0 ? HASHWX_INTERPRETED : HASHWX_COMPILED;
+            if (!run_load(type, s, threads, rate, duration, pool_size, jobs, latencies)) {
+                printf("%-12s %-7s not supported\n", c == 0 ? "interpreted" : "compiled", scenario_names[s]);
+            }
+        }
+    }
+    free(latencies);
+    free(jobs);
+    return 0;
+}
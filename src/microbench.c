@@ -0,0 +1,285 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+/*
+    Times each stage of hashwx_make and hashwx_exec separately and reports
+    the distribution of every stage over many seeds. The stages call the
+    same internal functions as the library, so the sum of the stages is
+    close to the time of the corresponding public function.
+
+    On x86-64, times are measured with rdtsc, which counts reference cycles
+    at the nominal frequency of the CPU. Other platforms use a monotonic
+    clock in nanoseconds. The "timer" stage is the overhead of one
+    measurement, which is included in all other stages.
+
+    The exec_* stages run each function for the first time after it was
+    made and the hash_* stages hash the same nonce again, so the difference
+    between them is mostly the cost of untrained branch predictors.
+    The register phase and the memory phase are timed separately for the
+    interpreter. The compiled function runs both phases in one call.
+*/
+
+#include "test_utils.h"
+#include "platform.h"
+#include "siphash_rng.h"
+#include "program.h"
+#include "compiler.h"
+#include "context.h"
+#include "virtual_memory.h"
+
+#include <hashwx.h>
+#include <inttypes.h>
+
+typedef enum stage_id {
+    STAGE_TIMER,
+    STAGE_RNG_INIT,
+    STAGE_GENERATE,
+#if HASHWX_COMPILER
+    STAGE_COMPILE_EMIT,
+    STAGE_COMPILE_PROTECT,
+    STAGE_COMPILE_FUSED,
+#endif
+    STAGE_MAKE_INTERPRETED,
+#if HASHWX_COMPILER
+    STAGE_MAKE_COMPILED,
+#endif
+    STAGE_EXEC_INIT,
+    STAGE_EXEC_REG_INTERPRETED,
+    STAGE_EXEC_MEM_INTERPRETED,
+#if HASHWX_COMPILER
+    STAGE_EXEC_COMPILED,
+#endif
+    STAGE_EXEC_FINALIZE,
+    STAGE_HASH_INTERPRETED,
+#if HASHWX_COMPILER
+    STAGE_HASH_COMPILED,
+#endif
+    STAGE_COUNT
+} stage_id;
+
+static const char* stage_names[STAGE_COUNT] = {
+    [STAGE_TIMER] = "timer",
+    [STAGE_RNG_INIT] = "rng_init",
+    [STAGE_GENERATE] = "program_list_generate",
+#if HASHWX_COMPILER
+    [STAGE_COMPILE_EMIT] = "compile_emit",
+    [STAGE_COMPILE_PROTECT] = "compile_protect",
+    [STAGE_COMPILE_FUSED] = "compile_fused",
+#endif
+    [STAGE_MAKE_INTERPRETED] = "make_interpreted",
+#if HASHWX_COMPILER
+    [STAGE_MAKE_COMPILED] = "make_compiled",
+#endif
+    [STAGE_EXEC_INIT] = "exec_init",
+    [STAGE_EXEC_REG_INTERPRETED] = "exec_reg_phase_interpreted",
+    [STAGE_EXEC_MEM_INTERPRETED] = "exec_mem_phase_interpreted",
+#if HASHWX_COMPILER
+    [STAGE_EXEC_COMPILED] = "exec_programs_compiled",
+#endif
+    [STAGE_EXEC_FINALIZE] = "exec_finalize",
+    [STAGE_HASH_INTERPRETED] = "hash_interpreted",
+#if HASHWX_COMPILER
+    [STAGE_HASH_COMPILED] = "hash_compiled",
+#endif
+};
+
+typedef struct stage_stats {
+    uint64_t min, p50, p99, p999, max;
+    double mean;
+} stage_stats;
+
+static const siphash_key bench_key = {
+    .k0 = 0x6d6963726f62656e,
+    .k1 = 0x6368206861736877
+};
+
+static void compute_stats(uint64_t* samples, size_t count, stage_stats* stats) {
+    qsort(samples, count, sizeof(uint64_t), &compare_u64);
+    double sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += (double)samples[i];
+    }
+    stats->min = samples[0];
+    stats->max = samples[count - 1];
+    stats->mean = sum / count;
+    stats->p50 = percentile(samples, count, 500);
+    stats->p99 = percentile(samples, count, 990);
+    stats->p999 = percentile(samples, count, 999);
+}
+
+int main(int argc, char** argv) {
+    int samples, warmup;
+    bool json;
+    read_int_option("--samples", argc, argv, &samples, 100000);
+    read_int_option("--warmup", argc, argv, &warmup, 1000);
+    read_option("--json", argc, argv, &json);
+    hashwx_ctx* ctx_int = hashwx_alloc(HASHWX_INTERPRETED);
+    hashwx_ctx* ctx_cmp = NULL;
+    uint64_t* times = malloc(sizeof(uint64_t) * STAGE_COUNT * samples);
+    hashwx_program_list* program_list = malloc(sizeof(hashwx_program_list));
+    if (ctx_int == NULL || times == NULL || program_list == NULL) {
+        printf("Error: memory allocation failure\n");
+        return 1;
+    }
+#if HASHWX_COMPILER
+    ctx_cmp = hashwx_alloc(HASHWX_COMPILED);
+    union {
+        uint8_t* code;
+        program_func* func;
+    } code;
+    code.code = hashwx_vm_alloc(HASHWX_CODE_SIZE);
+    if (ctx_cmp == NULL || ctx_cmp == HASHWX_NOTSUPP || code.code == NULL) {
+        printf("Error: memory allocation failure\n");
+        return 1;
+    }
+#endif
+    uint64_t hash_sum = 0;
+    for (int i = -warmup; i < samples; ++i) {
+        /* warm-up iterations overwrite the first sample */
+        uint64_t* t = &times[(i < 0 ? 0 : (size_t)i) * STAGE_COUNT];
+        uint64_t start, r[HASHWX_REG_SIZE], mem[HASHWX_MEM_SIZE];
+        siphash_rng gen;
+        siphash_key keys[2];
+        uint8_t seed[HASHWX_SEED_SIZE];
+        uint64_t nonce = (uint64_t)i;
+
+        start = timer_now();
+        t[STAGE_TIMER] = timer_now() - start;
+
+        start = timer_now();
+        hashwx_rng_init(&gen, &bench_key, (uint64_t)i);
+        t[STAGE_RNG_INIT] = timer_now() - start;
+        for (int j = 0; j < 4; ++j) {
+            platform_store64(&seed[8 * j], gen.state[j]);
+        }
+        keys[0].k0 = gen.state[0];
+        keys[0].k1 = gen.state[1];
+        keys[1].k0 = gen.state[2];
+        keys[1].k1 = gen.state[3];
+
+        start = timer_now();
+        hashwx_program_list_generate(&keys[0], program_list);
+        t[STAGE_GENERATE] = timer_now() - start;
+
+#if HASHWX_COMPILER
+        start = timer_now();
+        hashwx_vm_rw(code.code, HASHWX_CODE_SIZE);
+        t[STAGE_COMPILE_PROTECT] = timer_now() - start;
+
+        start = timer_now();
+        hashwx_compile(code.code, program_list);
+        t[STAGE_COMPILE_EMIT] = timer_now() - start;
+
+        start = timer_now();
+        hashwx_vm_rx(code.code, HASHWX_CODE_SIZE);
+#if (defined(HASHWX_COMPILER_A64) || defined(HASHWX_COMPILER_RV64)) && defined(__GNUC__)
+        __builtin___clear_cache((char*)code.code, (char*)code.code + HASHWX_CODE_SIZE);
+#endif
+        t[STAGE_COMPILE_PROTECT] += timer_now() - start;
+
+        hashwx_vm_rw(code.code, HASHWX_CODE_SIZE);
+        start = timer_now();
+        hashwx_compile_fused(code.code, &keys[0]);
+        t[STAGE_COMPILE_FUSED] = timer_now() - start;
+        hashwx_vm_rx(code.code, HASHWX_CODE_SIZE);
+#if (defined(HASHWX_COMPILER_A64) || defined(HASHWX_COMPILER_RV64)) && defined(__GNUC__)
+        __builtin___clear_cache((char*)code.code, (char*)code.code + HASHWX_CODE_SIZE);
+#endif
+#endif
+
+        start = timer_now();
+        hashwx_make(ctx_int, seed);
+        t[STAGE_MAKE_INTERPRETED] = timer_now() - start;
+
+#if HASHWX_COMPILER
+        start = timer_now();
+        hashwx_make(ctx_cmp, seed);
+        t[STAGE_MAKE_COMPILED] = timer_now() - start;
+#endif
+
+        start = timer_now();
+        init_registers(&keys[1], nonce, r);
+        t[STAGE_EXEC_INIT] = timer_now() - start;
+
+#if HASHWX_COMPILER
+        uint64_t r_cmp[HASHWX_REG_SIZE];
+        memcpy(r_cmp, r, sizeof(r));
+        start = timer_now();
+        code.func(r_cmp);
+        t[STAGE_EXEC_COMPILED] = timer_now() - start;
+#endif
+
+        start = timer_now();
+        hashwx_program_list_execute_reg(program_list, r, mem);
+        t[STAGE_EXEC_REG_INTERPRETED] = timer_now() - start;
+
+        start = timer_now();
+        hashwx_program_list_execute_mem(program_list, r, mem);
+        t[STAGE_EXEC_MEM_INTERPRETED] = timer_now() - start;
+
+        start = timer_now();
+        uint64_t hash = finalize_registers(r);
+        t[STAGE_EXEC_FINALIZE] = timer_now() - start;
+
+        start = timer_now();
+        uint64_t hash_int = hashwx_exec(ctx_int, nonce);
+        t[STAGE_HASH_INTERPRETED] = timer_now() - start;
+
+#if HASHWX_COMPILER
+        start = timer_now();
+        uint64_t hash_cmp = hashwx_exec(ctx_cmp, nonce);
+        t[STAGE_HASH_COMPILED] = timer_now() - start;
+        uint64_t hash_stage = finalize_registers(r_cmp);
+        if (hash_cmp != hash || hash_stage != hash) {
+            printf("Error: compiled hash mismatch for sample %i\n", i);
+            return 1;
+        }
+#endif
+        if (hash_int != hash) {
+            printf("Error: hash mismatch for sample %i\n", i);
+            return 1;
+        }
+        hash_sum ^= hash;
+    }
+    /* transpose the samples so that each stage is contiguous */
+    uint64_t* stage_times = malloc(sizeof(uint64_t) * samples);
+    stage_stats stats[STAGE_COUNT];
+    if (stage_times == NULL) {
+        printf("Error: memory allocation failure\n");
+        return 1;
+    }
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        for (int i = 0; i < samples; ++i) {
+            stage_times[i] = times[(size_t)i * STAGE_COUNT + s];
+        }
+        compute_stats(stage_times, samples, &stats[s]);
+    }
+    if (json) {
+        printf("{\n  \"unit\": \"%s\",\n  \"samples\": %i,\n  \"stages\": {\n", TIMER_UNIT, samples);
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            printf("    \"%s\": { \"min\": %" PRIu64 ", \"mean\": %.1f, \"p50\": %" PRIu64
+                ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64 ", \"max\": %" PRIu64 " }%s\n",
+                stage_names[s], stats[s].min, stats[s].mean, stats[s].p50,
+                stats[s].p99, stats[s].p999, stats[s].max, s + 1 < STAGE_COUNT ? "," : "");
+        }
+        printf("  }\n}\n");
+    }
+    else {
+        printf("Samples: %i, unit: %s, hash sum: %016" PRIx64 "\n", samples, TIMER_UNIT, hash_sum);
+        printf("%-26s %10s %10s %10s %10s %10s %10s\n", "stage", "min", "mean", "p50", "p99", "p99.9", "max");
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            printf("%-26s %10" PRIu64 " %10.1f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+                stage_names[s], stats[s].min, stats[s].mean, stats[s].p50,
+                stats[s].p99, stats[s].p999, stats[s].max);
+        }
+    }
+#if HASHWX_COMPILER
+    hashwx_vm_free(code.code, HASHWX_CODE_SIZE);
+#endif
+    hashwx_free(ctx_int);
+    hashwx_free(ctx_cmp);
+    free(program_list);
+    free(stage_times);
+    free(times);
+    return 0;
+}
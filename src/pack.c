@@ -0,0 +1,197 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <hashwx.h>
+#include "platform.h"
+#include "virtual_memory.h"
+
+#ifdef HASHWX_WIN
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+    Program pack format:
+
+    0-7      'H', 'W', 'X', 'P', 'A', 'C', 'K', PACK_VERSION
+    8-15     number of seeds N in little endian
+    16-      N seeds sorted by memcmp, 32 bytes each
+             N exported functions in the same order, HASHWX_EXPORT_SIZE
+             bytes each
+
+    The seeds are stored apart from the functions, so a lookup only
+    touches the pages of the index.
+
+    A pack is written to a temporary file next to it, which is then renamed
+    over the old pack. Processes that have the old pack mapped keep reading
+    the old file instead of faulting on a truncated one.
+*/
+
+#define PACK_VERSION 1
+#define PACK_HEADER_SIZE 16
+#define PACK_ENTRY_SIZE (HASHWX_SEED_SIZE + HASHWX_EXPORT_SIZE)
+
+static const uint8_t pack_magic[8] = { 'H', 'W', 'X', 'P', 'A', 'C', 'K', PACK_VERSION };
+
+struct hashwx_pack {
+    const uint8_t* data;
+    size_t size;
+    size_t count;
+    const uint8_t* seeds;
+    const uint8_t* functions;
+};
+
+static int compare_seeds(const void* a, const void* b) {
+    return memcmp(a, b, HASHWX_SEED_SIZE);
+}
+
+/* Creates a temporary file for path. Its path is written to temp_path. */
+static FILE* open_temporary(const char* path, char* temp_path) {
+    strcpy(temp_path, path);
+#ifdef HASHWX_WIN
+    strcat(temp_path, ".tmp");
+    return fopen(temp_path, "wb");
+#else
+    strcat(temp_path, ".XXXXXX");
+    int fd = mkstemp(temp_path);
+    if (fd == -1) {
+        return NULL;
+    }
+    /* mkstemp creates files that only the owner can read */
+    FILE* file = NULL;
+    if (fchmod(fd, 0644) != 0 || (file = fdopen(fd, "wb")) == NULL) {
+        close(fd);
+        remove(temp_path);
+    }
+    return file;
+#endif
+}
+
+static bool replace_file(const char* temp_path, const char* path) {
+#ifdef HASHWX_WIN
+    return MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(temp_path, path) == 0;
+#endif
+}
+
+int hashwx_pack_write(const char* path, const uint8_t (*seeds)[HASHWX_SEED_SIZE], size_t count) {
+    assert(path != NULL);
+    assert(seeds != NULL || count == 0);
+    if (count > SIZE_MAX / HASHWX_SEED_SIZE) {
+        return 0;
+    }
+    /* +1 so that an empty pack doesn't depend on malloc(0) */
+    uint8_t (*sorted)[HASHWX_SEED_SIZE] = malloc(count * HASHWX_SEED_SIZE + 1);
+    if (sorted == NULL) {
+        return 0;
+    }
+    if (count > 0) {
+        memcpy(sorted, seeds, count * HASHWX_SEED_SIZE);
+        qsort(sorted, count, HASHWX_SEED_SIZE, &compare_seeds);
+    }
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (unique == 0 || memcmp(sorted[unique - 1], sorted[i], HASHWX_SEED_SIZE) != 0) {
+            memmove(sorted[unique++], sorted[i], HASHWX_SEED_SIZE);
+        }
+    }
+    /* ".XXXXXX" or ".tmp" */
+    char* temp_path = malloc(strlen(path) + 8);
+    FILE* file = temp_path != NULL ? open_temporary(path, temp_path) : NULL;
+    if (file == NULL) {
+        free(temp_path);
+        free(sorted);
+        return 0;
+    }
+    uint8_t header[PACK_HEADER_SIZE];
+    memcpy(header, pack_magic, sizeof(pack_magic));
+    platform_store64(&header[8], unique);
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    if (ok && unique > 0) {
+        ok = fwrite(sorted, HASHWX_SEED_SIZE, unique, file) == unique;
+    }
+    uint8_t function[HASHWX_EXPORT_SIZE];
+    for (size_t i = 0; ok && i < unique; ++i) {
+        hashwx_export_program(sorted[i], function);
+        ok = fwrite(function, sizeof(function), 1, file) == 1;
+    }
+    ok = fclose(file) == 0 && ok;
+    ok = ok && replace_file(temp_path, path);
+    if (!ok) {
+        remove(temp_path);
+    }
+    free(temp_path);
+    free(sorted);
+    return ok;
+}
+
+hashwx_pack* hashwx_pack_open(const char* path) {
+    assert(path != NULL);
+#ifdef __wasm__
+    (void)path;
+    return NULL;
+#else
+    hashwx_pack* pack = malloc(sizeof(hashwx_pack));
+    if (pack == NULL) {
+        return NULL;
+    }
+    pack->data = hashwx_vm_map_file(path, &pack->size);
+    if (pack->data == NULL) {
+        free(pack);
+        return NULL;
+    }
+    if (pack->size < PACK_HEADER_SIZE || memcmp(pack->data, pack_magic, sizeof(pack_magic)) != 0) {
+        goto invalid;
+    }
+    uint64_t count = platform_load64(&pack->data[8]);
+    if (count > (pack->size - PACK_HEADER_SIZE) / PACK_ENTRY_SIZE ||
+        pack->size != PACK_HEADER_SIZE + count * PACK_ENTRY_SIZE) {
+        goto invalid;
+    }
+    pack->count = (size_t)count;
+    pack->seeds = &pack->data[PACK_HEADER_SIZE];
+    pack->functions = &pack->seeds[pack->count * HASHWX_SEED_SIZE];
+    return pack;
+invalid:
+    hashwx_pack_close(pack);
+    return NULL;
+#endif
+}
+
+const uint8_t* hashwx_pack_find(const hashwx_pack* pack, const uint8_t seed[HASHWX_SEED_SIZE]) {
+    assert(pack != NULL);
+    assert(seed != NULL);
+    size_t lo = 0, hi = pack->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(&pack->seeds[mid * HASHWX_SEED_SIZE], seed, HASHWX_SEED_SIZE);
+        if (cmp == 0) {
+            return &pack->functions[mid * HASHWX_EXPORT_SIZE];
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+void hashwx_pack_close(hashwx_pack* pack) {
+    if (pack != NULL) {
+#ifndef __wasm__
+        hashwx_vm_unmap_file(pack->data, pack->size);
+#endif
+        free(pack);
+    }
+}
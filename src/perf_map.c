@@ -0,0 +1,160 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perf_map.h"
+#include "compiler.h"
+#include "program.h"
+#include "worker_pool.h"
+
+/*
+    When the environment variable HASHWX_PERF_MAP is set to a value other
+    than 0, the parts of every compiled function are appended to
+    /tmp/perf-<pid>.map, which is where Linux perf looks up the symbols of
+    JIT code:
+
+    hashwx_prologue           start of the program function
+    hashwx_epilogue           end of the program function
+    hashwx_body_begin         start of the body called by the program function
+    hashwx_reg_program_<i>    register phase of program i
+    hashwx_mem_begin          end of the register phase
+    hashwx_mem_program_<i>    memory phase of program i
+    hashwx_body_end           end of the body
+    hashwx_loop               nonce loop of hashwx_exec_batch and hashwx_search
+
+    When the body is inlined in the program function (RISC-V), there are
+    no body entries and hashwx_epilogue follows the memory phase.
+
+    All functions have the same layout, so the entries of an address stay
+    valid for every function at that address. They are written once per
+    address: once per code buffer when it's allocated and once per address
+    that a code cache file is mapped at. The kernel mostly reuses the
+    addresses of unmapped files, so the map file stops growing once all
+    instances have mapped a few files.
+*/
+
+#if defined(__linux__) && HASHWX_COMPILER && !defined(HASHWX_COMPILER_WASM)
+#define HAVE_PERF_MAP
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_PERF_MAP
+
+/* longest line: address, size and symbol name */
+#define MAX_LINE 64
+#define NUM_ENTRIES (2 * HASHWX_NUM_PROGRAMS + 6)
+
+static int add_entry(char* buffer, const uint8_t* code, uint32_t offset, uint32_t size,
+    const char* name, int index) {
+    char symbol[32];
+    if (index >= 0) {
+        snprintf(symbol, sizeof(symbol), "%s%i", name, index);
+    }
+    else {
+        snprintf(symbol, sizeof(symbol), "%s", name);
+    }
+    return snprintf(buffer, MAX_LINE, "%lx %x %s\n",
+        (unsigned long)(uintptr_t)(code + offset), (unsigned)size, symbol);
+}
+
+/* addresses that already have entries */
+static const uint8_t** known;
+static size_t known_count, known_capacity;
+static hashwx_mutex known_lock;
+
+#ifdef HASHWX_THREADS
+static once_flag known_once = ONCE_FLAG_INIT;
+
+static void known_init(void) {
+    hashwx_mutex_init(&known_lock);
+}
+#endif
+
+/* Returns false if code already has entries or can't be recorded */
+static bool add_known(const uint8_t* code) {
+#ifdef HASHWX_THREADS
+    call_once(&known_once, &known_init);
+#endif
+    bool added = false;
+    hashwx_mutex_lock(&known_lock);
+    size_t i = 0;
+    while (i < known_count && known[i] != code) {
+        i++;
+    }
+    if (i == known_count) {
+        if (known_count == known_capacity) {
+            size_t capacity = known_capacity > 0 ? 2 * known_capacity : 16;
+            const uint8_t** grown = realloc((void*)known, capacity * sizeof(const uint8_t*));
+            if (grown != NULL) {
+                known = grown;
+                known_capacity = capacity;
+            }
+        }
+        if (known_count < known_capacity) {
+            known[known_count++] = code;
+            added = true;
+        }
+    }
+    hashwx_mutex_unlock(&known_lock);
+    return added;
+}
+
+#endif
+
+void hashwx_perf_map_add(const uint8_t* code) {
+#ifdef HAVE_PERF_MAP
+    const char* env = getenv("HASHWX_PERF_MAP");
+    if (env == NULL || *env == '\0' || strcmp(env, "0") == 0) {
+        return;
+    }
+    if (!add_known(code)) {
+        return;
+    }
+    const hashwx_code_layout* layout = &hashwx_layout;
+    char buffer[NUM_ENTRIES * MAX_LINE];
+    int length = 0;
+    if (layout->body != 0) {
+        length += add_entry(&buffer[length], code, 0, layout->epilogue, "hashwx_prologue", -1);
+        length += add_entry(&buffer[length], code, layout->epilogue, layout->body - layout->epilogue,
+            "hashwx_epilogue", -1);
+        length += add_entry(&buffer[length], code, layout->body, layout->reg_phase - layout->body,
+            "hashwx_body_begin", -1);
+    }
+    else {
+        length += add_entry(&buffer[length], code, 0, layout->reg_phase, "hashwx_prologue", -1);
+    }
+    for (int i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        length += add_entry(&buffer[length], code, layout->reg_phase + i * layout->reg_program_size,
+            layout->reg_program_size, "hashwx_reg_program_", i);
+    }
+    uint32_t reg_end = layout->reg_phase + HASHWX_NUM_PROGRAMS * layout->reg_program_size;
+    length += add_entry(&buffer[length], code, reg_end, layout->mem_phase - reg_end, "hashwx_mem_begin", -1);
+    for (int i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        length += add_entry(&buffer[length], code, layout->mem_phase + i * layout->mem_program_size,
+            layout->mem_program_size, "hashwx_mem_program_", i);
+    }
+    uint32_t mem_end = layout->mem_phase + HASHWX_NUM_PROGRAMS * layout->mem_program_size;
+    uint32_t loop = layout->loop != 0 ? layout->loop : layout->size;
+    length += add_entry(&buffer[length], code, mem_end, loop - mem_end,
+        layout->body != 0 ? "hashwx_body_end" : "hashwx_epilogue", -1);
+    if (loop != layout->size) {
+        length += add_entry(&buffer[length], code, loop, layout->size - loop, "hashwx_loop", -1);
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/perf-%ld.map", (long)getpid());
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return;
+    }
+    /* a single append, so that concurrent instances don't interleave */
+    ssize_t written = write(fd, buffer, (size_t)length);
+    (void)written;
+    close(fd);
+#else
+    (void)code;
+#endif
+}
@@ -0,0 +1,13 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef PERF_MAP_H
+#define PERF_MAP_H
+
+#include <stdint.h>
+#include <hashwx.h>
+
+/* Describes the compiled function at code to perf if it's enabled */
+HASHWX_PRIVATE void hashwx_perf_map_add(const uint8_t* code);
+
+#endif
@@ -8,6 +8,7 @@
 #include <windows.h>
 #else
 #include <sys/time.h>
+#include <time.h>
 #endif
 
 double platform_wall_clock(void) {
@@ -33,3 +34,25 @@ double platform_wall_clock(void) {
     return (double)time.tv_sec + (double)time.tv_usec * 1.0e-6;
 #endif
 }
+
+uint64_t platform_monotonic_ns(void) {
+#ifdef HASHWX_WIN
+    static double freq = 0;
+    if (freq == 0) {
+        LARGE_INTEGER freq_long;
+        if (!QueryPerformanceFrequency(&freq_long)) {
+            return 0;
+        }
+        freq = (double)freq_long.QuadPart;
+    }
+    LARGE_INTEGER time;
+    if (!QueryPerformanceCounter(&time)) {
+        return 0;
+    }
+    return (uint64_t)(time.QuadPart * 1.0e9 / freq);
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+#endif
+}
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <assert.h>
+#include <hashwx.h>
 
 #ifndef PLATFORM_H
 #define PLATFORM_H
@@ -102,6 +103,46 @@ static FORCE_INLINE uint64_t platform_load64(const void* src) {
 #endif
 }
 
-double platform_wall_clock(void);
+static FORCE_INLINE void platform_store32(void* dst, uint32_t w) {
+#if defined(PLATFORM_LE)
+    memcpy(dst, &w, sizeof w);
+#else
+    uint8_t* p = (uint8_t*)dst;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+#endif
+}
+
+static FORCE_INLINE void platform_store64(void* dst, uint64_t w) {
+#if defined(PLATFORM_LE)
+    memcpy(dst, &w, sizeof w);
+#else
+    uint8_t* p = (uint8_t*)dst;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+    w >>= 8;
+    *p++ = (uint8_t)w;
+#endif
+}
+
+HASHWX_PRIVATE double platform_wall_clock(void);
+/* monotonic time in nanoseconds */
+HASHWX_PRIVATE uint64_t platform_monotonic_ns(void);
 
 #endif /* PLATFORM_H */
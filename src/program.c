@@ -37,6 +37,7 @@ static const instr_type xas_lookup[NUM_XAS_OPCODES] = {
     INSTR_SUBLSR
 };
 
+/* Permitted source permutations, sorted for import_program */
 static const uint8_t src_lookup[NUM_SRC_PERM][8] = {
     { 0, 3, 1, 4, 5, 6, 7, 2 }, { 0, 3, 1, 4, 6, 7, 5, 2 },
     { 0, 3, 1, 4, 7, 6, 5, 2 }, { 0, 3, 4, 1, 5, 6, 7, 2 },
@@ -394,7 +395,7 @@ static uint32_t gen_imm(instr_type opcode, uint64_t select) {
     return 1 + (select % 3); /* 1-3 */
 }
 
-static void program_generate(siphash_rng* gen, hashwx_program* program) {
+void hashwx_program_generate(siphash_rng* gen, hashwx_program* program) {
     /*
         The program layout is as follows:
 
@@ -461,10 +462,145 @@ static void program_generate(siphash_rng* gen, hashwx_program* program) {
     program->code[9].opcode = INSTR_HALT;
 }
 
+void hashwx_program_gen_init(const siphash_key* key, siphash_rng* gen) {
+    hashwx_rng_init(gen, key, (uint64_t)-1);
+}
+
 void hashwx_program_list_generate(const siphash_key* key, hashwx_program_list* program_list) {
     siphash_rng gen;
-    hashwx_rng_init(&gen, key, (uint64_t)-1);
+    hashwx_program_gen_init(key, &gen);
+    for (int i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        hashwx_program_generate(&gen, &program_list->prog[i]);
+    }
+}
+
+/*
+    Export format (HASHWX_EXPORT_SIZE bytes):
+
+    0-3      'H', 'W', 'X', EXPORT_VERSION
+    4-19     register key (k0, k1) in little endian
+    20-1043  32 programs, 32 bytes each
+
+    BRANCH and HALT are always at the same position, so a program is
+    stored as its other 8 instructions (opcode, src, dst, imm).
+*/
+
+#define EXPORT_VERSION 1
+#define EXPORT_HEADER_SIZE 20
+#define EXPORT_INSTR_SIZE 4
+#define EXPORT_PROGRAM_SIZE (8 * EXPORT_INSTR_SIZE)
+
+static_assert(HASHWX_EXPORT_SIZE == EXPORT_HEADER_SIZE + HASHWX_NUM_PROGRAMS * EXPORT_PROGRAM_SIZE,
+    "HASHWX_EXPORT_SIZE doesn't match the export format");
+
+/* positions of the exported instructions in a program */
+static const uint8_t export_slots[8] = { 0, 1, 2, 3, 4, 5, 6, 8 };
+
+void hashwx_program_list_export(const hashwx_program_list* program_list, const siphash_key* key,
+    uint8_t out[HASHWX_EXPORT_SIZE]) {
+    out[0] = 'H';
+    out[1] = 'W';
+    out[2] = 'X';
+    out[3] = EXPORT_VERSION;
+    platform_store64(&out[4], key->k0);
+    platform_store64(&out[12], key->k1);
+    uint8_t* pos = &out[EXPORT_HEADER_SIZE];
+    for (int i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            const instruction* instr = &program_list->prog[i].code[export_slots[j]];
+            *pos++ = instr->opcode;
+            *pos++ = instr->src;
+            *pos++ = instr->dst;
+            *pos++ = instr->imm;
+        }
+    }
+}
+
+#define OPCODES_MUL ((1u << INSTR_MULOR) | (1u << INSTR_MULXOR) | (1u << INSTR_MULADD))
+#define OPCODES_XAS (((1u << (INSTR_SUBLSR + 1)) - 1) & ~((1u << INSTR_XORROR) - 1))
+#define IMMS_MUL ((1ull << 1) | (1ull << 9) | (1ull << 33))
+#define IMMS_ROR (~1ull) /* 1-63 */
+#define IMMS_SHIFT (0xeull) /* 1-3 */
+
+/* permitted opcodes and source registers of the exported instructions */
+static const uint16_t import_opcodes[8] = {
+    1u << INSTR_RMCG, OPCODES_XAS, OPCODES_MUL, OPCODES_XAS,
+    OPCODES_MUL, OPCODES_XAS, OPCODES_MUL, OPCODES_XAS
+};
+static const uint16_t import_sources[8] = {
+    0x300, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/* permitted immediate values of each opcode (see gen_imm) */
+static const uint64_t import_imms[16] = {
+    IMMS_MUL, IMMS_MUL, IMMS_MUL, IMMS_ROR,
+    IMMS_ROR, IMMS_ROR, IMMS_ROR,
+    IMMS_SHIFT, IMMS_SHIFT, IMMS_SHIFT,
+    IMMS_SHIFT, IMMS_SHIFT, IMMS_SHIFT
+};
+
+static int compare_src_perm(const void* a, const void* b) {
+    return memcmp(a, b, sizeof(src_lookup[0]));
+}
+
+/*
+    The interpreters and the compilers rely on the program layout, so
+    an imported program must be one that the generator could produce.
+    The compilers also schedule instructions across each other, which is
+    only valid for the permitted source permutations (see src_lookup).
+    The per-instruction checks are branchless because the data is almost
+    always valid.
+*/
+static bool import_program(const uint8_t* in, hashwx_program* program) {
+    uint32_t invalid = 0;
+    uint32_t dst_seen = 0;
+    for (int j = 0; j < 8; ++j) {
+        instruction* instr = &program->code[export_slots[j]];
+        uint32_t word = platform_load32(in);
+        memcpy(instr, in, EXPORT_INSTR_SIZE);
+        in += EXPORT_INSTR_SIZE;
+        uint32_t opcode = word & 0xff, src = (word >> 8) & 0xff, dst = (word >> 16) & 0xff, imm = word >> 24;
+        /* opcode < 16, src < 16, dst < 8, imm < 64 */
+        invalid |= word & 0xc0f8f0f0;
+        uint32_t ok = (uint32_t)(import_imms[opcode & 15] >> (imm & 63));
+        ok &= (uint32_t)import_opcodes[j] >> (opcode & 15);
+        ok &= (uint32_t)import_sources[j] >> (src & 15);
+        invalid |= ~ok & 1;
+        dst_seen |= 1u << (dst & 7);
+    }
+    program->code[7] = (instruction){ .opcode = INSTR_BRANCH };
+    program->code[9] = (instruction){ .opcode = INSTR_HALT };
+    /* the destinations must be a permutation of R0-R7 */
+    if (invalid != 0 || dst_seen != 0xff) {
+        return false;
+    }
+    /* the sources must be a permitted permutation of the destinations */
+    uint8_t dst_slot[8];
+    for (int j = 0; j < 8; ++j) {
+        dst_slot[program->code[export_slots[j]].dst] = j;
+    }
+    uint8_t src_perm[8];
+    src_perm[0] = 0 + 1 + 2 + 3 + 4 + 5 + 6 + 7;
+    for (int j = 1; j < 8; ++j) {
+        src_perm[j] = dst_slot[program->code[export_slots[j]].src];
+        src_perm[0] -= src_perm[j];
+    }
+    return bsearch(src_perm, src_lookup, NUM_SRC_PERM, sizeof(src_lookup[0]), compare_src_perm) != NULL;
+}
+
+bool hashwx_program_list_import(const uint8_t in[HASHWX_EXPORT_SIZE], hashwx_program_list* program_list,
+    siphash_key* key) {
+    if (in[0] != 'H' || in[1] != 'W' || in[2] != 'X' || in[3] != EXPORT_VERSION) {
+        return false;
+    }
+    const uint8_t* pos = &in[EXPORT_HEADER_SIZE];
     for (int i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
-        program_generate(&gen, &program_list->prog[i]);
+        if (!import_program(pos, &program_list->prog[i])) {
+            return false;
+        }
+        pos += EXPORT_PROGRAM_SIZE;
     }
+    key->k0 = platform_load64(&in[4]);
+    key->k1 = platform_load64(&in[12]);
+    return true;
 }
@@ -10,12 +10,20 @@
 #include "platform.h"
 #include "instruction.h"
 #include "siphash_rng.h"
+#include "cpu.h"
 
 #define HASHWX_PROGRAM_SIZE 10
 #define HASHWX_NUM_PROGRAMS 32
 #define HASHWX_REG_SIZE 10
 #define HASHWX_MEM_SIZE 256
 
+/* Maximum number of lanes of the SIMD interpreters */
+#define HASHWX_MAX_LANES 8
+
+#if defined(HASHWX_CPU_X86) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define HASHWX_PROGRAM_SIMD
+#endif
+
 typedef struct hashwx_program {
     instruction code[HASHWX_PROGRAM_SIZE];
 } hashwx_program;
@@ -24,13 +32,78 @@ typedef struct hashwx_program_list {
     hashwx_program prog[HASHWX_NUM_PROGRAMS];
 } hashwx_program_list;
 
+/*
+    Executes the same program list for several inputs in parallel.
+    r[i] are the registers of the i-th input.
+*/
+typedef void program_list_simd_func(const hashwx_program_list* program_list, uint64_t r[][HASHWX_REG_SIZE]);
+
+/* Initial registers of the given input and the hash of the final registers */
+static FORCE_INLINE void init_registers(const siphash_key* key, uint64_t input, uint64_t r[HASHWX_REG_SIZE]) {
+    siphash_rng gen;
+    hashwx_rng_init(&gen, key, input);
+    for (uint64_t i = 0; i < 8; ++i) {
+        r[i] = hashwx_rng_next(&gen);
+    }
+    //adjust R8 to be 3 mod 8
+    r[8] = (r[4] & -8) | 3;
+    //adjust R9 to be 5 mod 8
+    r[9] = (r[7] & -8) | 5;
+}
+
+static FORCE_INLINE uint64_t finalize_registers(uint64_t r[HASHWX_REG_SIZE]) {
+    SIPROUND(r[0], r[1], r[2], r[3]);
+    SIPROUND(r[4], r[5], r[6], r[7]);
+    return r[3] ^ r[7] ^ r[9];
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 HASHWX_PRIVATE void hashwx_program_list_generate(const siphash_key* key, hashwx_program_list* program_list);
 
-HASHWX_PRIVATE void hashwx_program_list_execute(const hashwx_program_list* program_list, uint64_t r[]);
+/*
+    Generates the programs of a program list one at a time. Calling
+    hashwx_program_generate HASHWX_NUM_PROGRAMS times gives the same
+    programs as hashwx_program_list_generate.
+*/
+HASHWX_PRIVATE void hashwx_program_gen_init(const siphash_key* key, siphash_rng* gen);
+HASHWX_PRIVATE void hashwx_program_generate(siphash_rng* gen, hashwx_program* program);
+
+/*
+    Converts a program list and the register key to the export format
+    and back. Import returns false if the data is not a valid program list.
+*/
+HASHWX_PRIVATE void hashwx_program_list_export(const hashwx_program_list* program_list, const siphash_key* key,
+    uint8_t out[HASHWX_EXPORT_SIZE]);
+HASHWX_PRIVATE bool hashwx_program_list_import(const uint8_t in[HASHWX_EXPORT_SIZE], hashwx_program_list* program_list,
+    siphash_key* key);
+
+/*
+    Returns the unused iterations of the branch counter of the register
+    phase in bits 0-7 and of the memory phase in bits 8-15.
+*/
+HASHWX_PRIVATE uint32_t hashwx_program_list_execute(const hashwx_program_list* program_list, uint64_t r[]);
+/*
+    The register phase and the memory phase of hashwx_program_list_execute.
+    The register phase fills mem, which is read by the memory phase.
+*/
+HASHWX_PRIVATE void hashwx_program_list_execute_reg(const hashwx_program_list* program_list, uint64_t r[], uint64_t mem[]);
+HASHWX_PRIVATE void hashwx_program_list_execute_mem(const hashwx_program_list* program_list, uint64_t r[], const uint64_t mem[]);
+
+/*
+    Returns the fastest SIMD interpreter supported by the CPU or NULL.
+    HASHWX_CPU_DISABLE=avx512 selects the 4-lane AVX2 interpreter.
+*/
+HASHWX_PRIVATE program_list_simd_func* hashwx_program_list_simd(int* lanes);
+
+#ifdef HASHWX_PROGRAM_SIMD
+/* 4 lanes */
+HASHWX_PRIVATE void hashwx_program_list_execute_avx2(const hashwx_program_list* program_list, uint64_t r[][HASHWX_REG_SIZE]);
+/* 8 lanes */
+HASHWX_PRIVATE void hashwx_program_list_execute_avx512(const hashwx_program_list* program_list, uint64_t r[][HASHWX_REG_SIZE]);
+#endif
 
 #ifdef __cplusplus
 }
@@ -10,139 +10,317 @@ static FORCE_INLINE uint64_t rotr64(uint64_t a, unsigned int b) {
     return (a >> b) | (a << (64 - b));
 }
 
-static uint32_t program_execute_reg(const hashwx_program* program, uint64_t r[], uint32_t branch_counter) {
+#ifndef HASHWX_GENERIC_INTERPRETER
+
+/*
+    Interpreter specialized for the fixed program layout (see
+    hashwx_program_generate). The loop body is unrolled, so only the MUL
+    and XAS slots dispatch among their opcode variants and there is no
+    instruction counter or HALT check. The HASHWX_GENERIC_INTERPRETER CMake
+    option selects the generic interpreter below, which makes no
+    assumptions about the layout.
+*/
+
+static FORCE_INLINE uint64_t load_src(const uint64_t r[], const uint64_t* mem, uint32_t src) {
+    if (mem == NULL) {
+        return r[src];
+    }
+    return mem[(r[src] / 8) % 256];
+}
+
+static FORCE_INLINE void execute_mul(const instruction* instr, uint64_t r[], const uint64_t* mem) {
+    uint64_t src = load_src(r, mem, instr->src);
+    switch (instr->opcode)
+    {
+    case INSTR_MULOR:
+        r[instr->dst] = (r[instr->dst] | instr->imm) * src;
+        break;
+    case INSTR_MULXOR:
+        r[instr->dst] = (r[instr->dst] ^ instr->imm) * src;
+        break;
+    case INSTR_MULADD:
+        r[instr->dst] = (r[instr->dst] + instr->imm) * src;
+        break;
+    default:
+        UNREACHABLE;
+    }
+}
+
+static FORCE_INLINE void execute_xas(const instruction* instr, uint64_t r[], const uint64_t* mem) {
+    uint64_t src = load_src(r, mem, instr->src);
+    switch (instr->opcode)
+    {
+    case INSTR_XORROR:
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) ^ src;
+        break;
+    case INSTR_ADDROR:
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) + src;
+        break;
+    case INSTR_SUBROR:
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) - src;
+        break;
+    case INSTR_XORASR:
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) ^ src;
+        break;
+    case INSTR_ADDASR:
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) + src;
+        break;
+    case INSTR_SUBASR:
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) - src;
+        break;
+    case INSTR_XORLSR:
+        r[instr->dst] = (r[instr->dst] >> instr->imm) ^ src;
+        break;
+    case INSTR_ADDLSR:
+        r[instr->dst] = (r[instr->dst] >> instr->imm) + src;
+        break;
+    case INSTR_SUBLSR:
+        r[instr->dst] = (r[instr->dst] >> instr->imm) - src;
+        break;
+    default:
+        UNREACHABLE;
+    }
+}
+
+static FORCE_INLINE uint32_t program_execute(const hashwx_program* program, uint64_t r[],
+    uint32_t branch_counter, const uint64_t* mem) {
+    const instruction* code = program->code;
+    assert(code[0].opcode == INSTR_RMCG);
+    assert(code[7].opcode == INSTR_BRANCH);
+    assert(code[9].opcode == INSTR_HALT);
+    for (;;) {
+        uint64_t temp = rotr64(r[code[0].dst] * r[code[0].src], code[0].imm);
+        r[code[0].dst] = temp;
+        execute_xas(&code[1], r, mem);
+        execute_mul(&code[2], r, mem);
+        execute_xas(&code[3], r, mem);
+        execute_mul(&code[4], r, mem);
+        execute_xas(&code[5], r, mem);
+        execute_mul(&code[6], r, mem);
+        /* INSTR_BRANCH */
+        if (branch_counter == 0 || (temp & 32) != 0) {
+            break;
+        }
+        branch_counter--;
+    }
+    execute_xas(&code[8], r, mem);
+    return branch_counter;
+}
+
+static FORCE_INLINE uint32_t program_execute_reg(const hashwx_program* program, uint64_t r[], uint32_t branch_counter) {
+    return program_execute(program, r, branch_counter, NULL);
+}
+
+static FORCE_INLINE uint32_t program_execute_mem(const hashwx_program* program, uint64_t r[], uint32_t branch_counter, const uint64_t mem[]) {
+    return program_execute(program, r, branch_counter, mem);
+}
+
+#else
+
+/*
+    With GCC and Clang, the interpreters are direct-threaded: each handler
+    ends with its own indirect jump to the handler of the next instruction
+    (labels as values). Compared to a single switch dispatch, the CPU can
+    predict each of these jumps separately, which matters here because the
+    VM executes only a few host instructions per VM instruction. Other
+    compilers and the HASHWX_NO_COMPUTED_GOTO CMake option use the portable
+    switch dispatch.
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(HASHWX_NO_COMPUTED_GOTO)
+#define HASHWX_COMPUTED_GOTO
+#endif
+
+#ifdef HASHWX_COMPUTED_GOTO
+
+#define DISPATCH_BEGIN \
+    static const void* const dispatch[] = { \
+        [INSTR_MULOR] = &&do_MULOR, \
+        [INSTR_MULXOR] = &&do_MULXOR, \
+        [INSTR_MULADD] = &&do_MULADD, \
+        [INSTR_RMCG] = &&do_RMCG, \
+        [INSTR_XORROR] = &&do_XORROR, \
+        [INSTR_ADDROR] = &&do_ADDROR, \
+        [INSTR_SUBROR] = &&do_SUBROR, \
+        [INSTR_XORASR] = &&do_XORASR, \
+        [INSTR_ADDASR] = &&do_ADDASR, \
+        [INSTR_SUBASR] = &&do_SUBASR, \
+        [INSTR_XORLSR] = &&do_XORLSR, \
+        [INSTR_ADDLSR] = &&do_ADDLSR, \
+        [INSTR_SUBLSR] = &&do_SUBLSR, \
+        [INSTR_BRANCH] = &&do_BRANCH, \
+        [INSTR_HALT] = &&do_HALT, \
+    }; \
+    NEXT;
+
+#define DISPATCH_END
+
+#define CASE(x) do_##x:
+
+#define NEXT \
+    do { \
+        instr = &program->code[ic++]; \
+        goto *dispatch[instr->opcode]; \
+    } while (0)
+
+#else
+
+#define DISPATCH_BEGIN \
+    for (;;) { /* loop is exited via the HALT instruction */ \
+        instr = &program->code[ic++]; \
+        switch (instr->opcode) \
+        {
+
+#define DISPATCH_END \
+        default: \
+            UNREACHABLE; \
+        } \
+    }
+
+#define CASE(x) case INSTR_##x:
+
+#define NEXT break
+
+#endif
+
+/* GCC can't inline functions that keep label addresses in a static table */
+#ifdef HASHWX_COMPUTED_GOTO
+#define GENERIC_INLINE
+#else
+#define GENERIC_INLINE FORCE_INLINE
+#endif
+
+#ifdef HASHWX_COMPUTED_GOTO
+/* labels as values are a GNU extension */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+static GENERIC_INLINE uint32_t program_execute_reg(const hashwx_program* program, uint64_t r[], uint32_t branch_counter) {
+    const instruction* instr;
     uint32_t branch_flag = 0;
     uint32_t ic = 0;
     uint64_t temp;
-    for (;;) { /* loop is exited via the HALT instruction below */
-        const instruction* instr = &program->code[ic];
-        ic++;
-        switch (instr->opcode)
-        {
-        case INSTR_MULOR:
-            r[instr->dst] = (r[instr->dst] | instr->imm) * r[instr->src];
-            break;
-        case INSTR_MULXOR:
-            r[instr->dst] = (r[instr->dst] ^ instr->imm) * r[instr->src];
-            break;
-        case INSTR_MULADD:
-            r[instr->dst] = (r[instr->dst] + instr->imm) * r[instr->src];
-            break;
-        case INSTR_RMCG:
-            temp = rotr64(r[instr->dst] * r[instr->src], instr->imm);
-            r[instr->dst] = temp;
-            branch_flag = (uint32_t)temp;
-            break;
-        case INSTR_XORROR:
-            r[instr->dst] = rotr64(r[instr->dst], instr->imm) ^ r[instr->src];
-            break;
-        case INSTR_ADDROR:
-            r[instr->dst] = rotr64(r[instr->dst], instr->imm) + r[instr->src];
-            break;
-        case INSTR_SUBROR:
-            r[instr->dst] = rotr64(r[instr->dst], instr->imm) - r[instr->src];
-            break;
-        case INSTR_XORASR:
-            r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) ^ r[instr->src];
-            break;
-        case INSTR_ADDASR:
-            r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) + r[instr->src];
-            break;
-        case INSTR_SUBASR:
-            r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) - r[instr->src];
-            break;
-        case INSTR_XORLSR:
-            r[instr->dst] = (r[instr->dst] >> instr->imm) ^ r[instr->src];
-            break;
-        case INSTR_ADDLSR:
-            r[instr->dst] = (r[instr->dst] >> instr->imm) + r[instr->src];
-            break;
-        case INSTR_SUBLSR:
-            r[instr->dst] = (r[instr->dst] >> instr->imm) - r[instr->src];
-            break;
-        case INSTR_BRANCH:
-            if (branch_counter != 0 && (branch_flag & 32) == 0) {
-                branch_counter--;
-                ic = 0;
-            }
-            break;
-        case INSTR_HALT:
-            return branch_counter;
-        default:
-            UNREACHABLE;
+    DISPATCH_BEGIN
+    CASE(MULOR)
+        r[instr->dst] = (r[instr->dst] | instr->imm) * r[instr->src];
+        NEXT;
+    CASE(MULXOR)
+        r[instr->dst] = (r[instr->dst] ^ instr->imm) * r[instr->src];
+        NEXT;
+    CASE(MULADD)
+        r[instr->dst] = (r[instr->dst] + instr->imm) * r[instr->src];
+        NEXT;
+    CASE(RMCG)
+        temp = rotr64(r[instr->dst] * r[instr->src], instr->imm);
+        r[instr->dst] = temp;
+        branch_flag = (uint32_t)temp;
+        NEXT;
+    CASE(XORROR)
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) ^ r[instr->src];
+        NEXT;
+    CASE(ADDROR)
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) + r[instr->src];
+        NEXT;
+    CASE(SUBROR)
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) - r[instr->src];
+        NEXT;
+    CASE(XORASR)
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) ^ r[instr->src];
+        NEXT;
+    CASE(ADDASR)
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) + r[instr->src];
+        NEXT;
+    CASE(SUBASR)
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) - r[instr->src];
+        NEXT;
+    CASE(XORLSR)
+        r[instr->dst] = (r[instr->dst] >> instr->imm) ^ r[instr->src];
+        NEXT;
+    CASE(ADDLSR)
+        r[instr->dst] = (r[instr->dst] >> instr->imm) + r[instr->src];
+        NEXT;
+    CASE(SUBLSR)
+        r[instr->dst] = (r[instr->dst] >> instr->imm) - r[instr->src];
+        NEXT;
+    CASE(BRANCH)
+        if (branch_counter != 0 && (branch_flag & 32) == 0) {
+            branch_counter--;
+            ic = 0;
         }
-    }
+        NEXT;
+    CASE(HALT)
+        return branch_counter;
+    DISPATCH_END
     UNREACHABLE;
 }
 
-static uint32_t program_execute_mem(const hashwx_program* program, uint64_t r[], uint32_t branch_counter, uint64_t mem[]) {
+static GENERIC_INLINE uint32_t program_execute_mem(const hashwx_program* program, uint64_t r[], uint32_t branch_counter, const uint64_t mem[]) {
+    const instruction* instr;
     uint32_t branch_flag = 0;
     uint32_t ic = 0;
     uint64_t temp;
-    for (;;) { /* loop is exited via the HALT instruction below */
-        const instruction* instr = &program->code[ic];
-        ic++;
-        switch (instr->opcode)
-        {
-        case INSTR_MULOR:
-            r[instr->dst] = (r[instr->dst] | instr->imm) * mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_MULXOR:
-            r[instr->dst] = (r[instr->dst] ^ instr->imm) * mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_MULADD:
-            r[instr->dst] = (r[instr->dst] + instr->imm) * mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_RMCG:
-            temp = rotr64(r[instr->dst] * r[instr->src], instr->imm);
-            r[instr->dst] = temp;
-            branch_flag = (uint32_t)temp;
-            break;
-        case INSTR_XORROR:
-            r[instr->dst] = rotr64(r[instr->dst], instr->imm) ^ mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_ADDROR:
-            r[instr->dst] = rotr64(r[instr->dst], instr->imm) + mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_SUBROR:
-            r[instr->dst] = rotr64(r[instr->dst], instr->imm) - mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_XORASR:
-            r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) ^ mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_ADDASR:
-            r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) + mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_SUBASR:
-            r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) - mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_XORLSR:
-            r[instr->dst] = (r[instr->dst] >> instr->imm) ^ mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_ADDLSR:
-            r[instr->dst] = (r[instr->dst] >> instr->imm) + mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_SUBLSR:
-            r[instr->dst] = (r[instr->dst] >> instr->imm) - mem[(r[instr->src] / 8) % 256];
-            break;
-        case INSTR_BRANCH:
-            if (branch_counter != 0 && (branch_flag & 32) == 0) {
-                branch_counter--;
-                ic = 0;
-            }
-            break;
-        case INSTR_HALT:
-            return branch_counter;
-        default:
-            UNREACHABLE;
+    DISPATCH_BEGIN
+    CASE(MULOR)
+        r[instr->dst] = (r[instr->dst] | instr->imm) * mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(MULXOR)
+        r[instr->dst] = (r[instr->dst] ^ instr->imm) * mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(MULADD)
+        r[instr->dst] = (r[instr->dst] + instr->imm) * mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(RMCG)
+        temp = rotr64(r[instr->dst] * r[instr->src], instr->imm);
+        r[instr->dst] = temp;
+        branch_flag = (uint32_t)temp;
+        NEXT;
+    CASE(XORROR)
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) ^ mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(ADDROR)
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) + mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(SUBROR)
+        r[instr->dst] = rotr64(r[instr->dst], instr->imm) - mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(XORASR)
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) ^ mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(ADDASR)
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) + mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(SUBASR)
+        r[instr->dst] = (((int64_t)r[instr->dst]) >> instr->imm) - mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(XORLSR)
+        r[instr->dst] = (r[instr->dst] >> instr->imm) ^ mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(ADDLSR)
+        r[instr->dst] = (r[instr->dst] >> instr->imm) + mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(SUBLSR)
+        r[instr->dst] = (r[instr->dst] >> instr->imm) - mem[(r[instr->src] / 8) % 256];
+        NEXT;
+    CASE(BRANCH)
+        if (branch_counter != 0 && (branch_flag & 32) == 0) {
+            branch_counter--;
+            ic = 0;
         }
-    }
+        NEXT;
+    CASE(HALT)
+        return branch_counter;
+    DISPATCH_END
     UNREACHABLE;
 }
 
-void hashwx_program_list_execute(const hashwx_program_list* program_list, uint64_t r[]) {
+#ifdef HASHWX_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+#endif /* HASHWX_GENERIC_INTERPRETER */
+
+static FORCE_INLINE uint32_t execute_reg_phase(const hashwx_program_list* program_list, uint64_t r[], uint64_t mem[]) {
     uint32_t branch_counter = 32;
-    uint64_t mem[HASHWX_MEM_SIZE];
 
     for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
         branch_counter = program_execute_reg(&program_list->prog[i], r, branch_counter);
@@ -150,10 +328,45 @@ void hashwx_program_list_execute(const hashwx_program_list* program_list, uint64
             mem[HASHWX_MEM_SIZE - 1 - 8 * i - j] = r[j];
         }
     }
+    return branch_counter;
+}
 
-    branch_counter = 32;
+static FORCE_INLINE uint32_t execute_mem_phase(const hashwx_program_list* program_list, uint64_t r[], const uint64_t mem[]) {
+    uint32_t branch_counter = 32;
 
     for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
         branch_counter = program_execute_mem(&program_list->prog[i], r, branch_counter, mem);
     }
+    return branch_counter;
+}
+
+uint32_t hashwx_program_list_execute(const hashwx_program_list* program_list, uint64_t r[]) {
+    uint64_t mem[HASHWX_MEM_SIZE];
+    uint32_t reg_counter = execute_reg_phase(program_list, r, mem);
+    uint32_t mem_counter = execute_mem_phase(program_list, r, mem);
+    return reg_counter | mem_counter << 8;
+}
+
+void hashwx_program_list_execute_reg(const hashwx_program_list* program_list, uint64_t r[], uint64_t mem[]) {
+    execute_reg_phase(program_list, r, mem);
+}
+
+void hashwx_program_list_execute_mem(const hashwx_program_list* program_list, uint64_t r[], const uint64_t mem[]) {
+    execute_mem_phase(program_list, r, mem);
+}
+
+program_list_simd_func* hashwx_program_list_simd(int* lanes) {
+#ifdef HASHWX_PROGRAM_SIMD
+    uint32_t features = hashwx_cpu_features();
+    if (features & HASHWX_CPU_AVX512) {
+        *lanes = 8;
+        return &hashwx_program_list_execute_avx512;
+    }
+    if (features & HASHWX_CPU_AVX2) {
+        *lanes = 4;
+        return &hashwx_program_list_execute_avx2;
+    }
+#endif
+    *lanes = 1;
+    return NULL;
 }
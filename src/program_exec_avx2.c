@@ -0,0 +1,185 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include "program.h"
+
+#ifdef HASHWX_PROGRAM_SIMD
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+#define LANES 4
+
+/*
+    Interpreter that executes the same program list for 4 inputs in
+    lock-step. Each 256-bit vector holds one VM register of all lanes.
+    Lanes that don't take a branch are masked off until all lanes have
+    left the loop. The scratchpad is interleaved, i.e. mem[i] holds the
+    i-th memory word of all lanes.
+*/
+
+TARGET_AVX2
+static FORCE_INLINE __m256i mul64(__m256i a, __m256i b) {
+    /* there is no 64-bit multiplication in AVX2 */
+    __m256i lo = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(
+        _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+        _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+TARGET_AVX2
+static FORCE_INLINE __m256i rotr64(__m256i a, uint32_t b) {
+    return _mm256_or_si256(
+        _mm256_srl_epi64(a, _mm_cvtsi32_si128(b)),
+        _mm256_sll_epi64(a, _mm_cvtsi32_si128(64 - b)));
+}
+
+TARGET_AVX2
+static FORCE_INLINE __m256i sar64(__m256i a, uint32_t b) {
+    /* there is no 64-bit arithmetic shift in AVX2 */
+    __m128i count = _mm_cvtsi32_si128(b);
+    __m256i sign = _mm256_srl_epi64(_mm256_set1_epi64x(INT64_MIN), count);
+    __m256i shifted = _mm256_srl_epi64(a, count);
+    return _mm256_sub_epi64(_mm256_xor_si256(shifted, sign), sign);
+}
+
+TARGET_AVX2
+static FORCE_INLINE __m256i shr64(__m256i a, uint32_t b) {
+    return _mm256_srl_epi64(a, _mm_cvtsi32_si128(b));
+}
+
+TARGET_AVX2
+static FORCE_INLINE __m256i load_src(const __m256i r[], const __m256i* mem, uint32_t src) {
+    if (mem == NULL) {
+        return r[src];
+    }
+    /* interleaved index ((r[src] / 8) % 256) * LANES + lane */
+    const __m256i lane = _mm256_set_epi64x(3, 2, 1, 0);
+    __m256i index = _mm256_and_si256(_mm256_srli_epi64(r[src], 1), _mm256_set1_epi64x(255 * LANES));
+    index = _mm256_or_si256(index, lane);
+    return _mm256_i64gather_epi64((const long long*)mem, index, 8);
+}
+
+TARGET_AVX2
+static FORCE_INLINE __m256i execute_instr(const instruction* instr, const __m256i r[], const __m256i* mem) {
+    __m256i dst = r[instr->dst];
+    uint32_t imm = instr->imm;
+    switch (instr->opcode)
+    {
+    case INSTR_MULOR:
+        return mul64(_mm256_or_si256(dst, _mm256_set1_epi64x(imm)), load_src(r, mem, instr->src));
+    case INSTR_MULXOR:
+        return mul64(_mm256_xor_si256(dst, _mm256_set1_epi64x(imm)), load_src(r, mem, instr->src));
+    case INSTR_MULADD:
+        return mul64(_mm256_add_epi64(dst, _mm256_set1_epi64x(imm)), load_src(r, mem, instr->src));
+    case INSTR_RMCG:
+        return rotr64(mul64(dst, r[instr->src]), imm);
+    case INSTR_XORROR:
+        return _mm256_xor_si256(rotr64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_ADDROR:
+        return _mm256_add_epi64(rotr64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_SUBROR:
+        return _mm256_sub_epi64(rotr64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_XORASR:
+        return _mm256_xor_si256(sar64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_ADDASR:
+        return _mm256_add_epi64(sar64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_SUBASR:
+        return _mm256_sub_epi64(sar64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_XORLSR:
+        return _mm256_xor_si256(shr64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_ADDLSR:
+        return _mm256_add_epi64(shr64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_SUBLSR:
+        return _mm256_sub_epi64(shr64(dst, imm), load_src(r, mem, instr->src));
+    default:
+        UNREACHABLE;
+    }
+}
+
+/*
+    Relies on the fixed program layout (see hashwx_program_generate): the loop
+    body is instructions 0-6 starting with INSTR_RMCG, instruction 7 is
+    INSTR_BRANCH and instruction 8 is executed once after the loop.
+*/
+TARGET_AVX2
+static FORCE_INLINE void program_execute(const hashwx_program* program, __m256i r[],
+    __m256i* branch_counter, const __m256i* mem) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i active = _mm256_set1_epi64x(-1);
+    __m256i counter = *branch_counter;
+    for (;;) {
+        __m256i flag = execute_instr(&program->code[0], r, mem);
+        r[program->code[0].dst] = _mm256_blendv_epi8(r[program->code[0].dst], flag, active);
+        for (int ic = 1; ic < 7; ++ic) {
+            const instruction* instr = &program->code[ic];
+            __m256i value = execute_instr(instr, r, mem);
+            r[instr->dst] = _mm256_blendv_epi8(r[instr->dst], value, active);
+        }
+        /* INSTR_BRANCH */
+        __m256i taken = _mm256_andnot_si256(_mm256_cmpeq_epi64(counter, zero), active);
+        flag = _mm256_and_si256(flag, _mm256_set1_epi64x(32));
+        taken = _mm256_and_si256(taken, _mm256_cmpeq_epi64(flag, zero));
+        if (_mm256_testz_si256(taken, taken)) {
+            break;
+        }
+        counter = _mm256_add_epi64(counter, taken);
+        active = taken;
+    }
+    *branch_counter = counter;
+    const instruction* instr = &program->code[8];
+    r[instr->dst] = execute_instr(instr, r, mem);
+}
+
+TARGET_AVX2
+static void program_execute_reg(const hashwx_program* program, __m256i r[], __m256i* branch_counter) {
+    program_execute(program, r, branch_counter, NULL);
+}
+
+TARGET_AVX2
+static void program_execute_mem(const hashwx_program* program, __m256i r[], __m256i* branch_counter,
+    const __m256i mem[]) {
+    program_execute(program, r, branch_counter, mem);
+}
+
+TARGET_AVX2
+void hashwx_program_list_execute_avx2(const hashwx_program_list* program_list, uint64_t r[][HASHWX_REG_SIZE]) {
+    __m256i reg[HASHWX_REG_SIZE];
+    __m256i mem[HASHWX_MEM_SIZE];
+    __m256i branch_counter;
+
+    for (int i = 0; i < HASHWX_REG_SIZE; ++i) {
+        reg[i] = _mm256_set_epi64x(r[3][i], r[2][i], r[1][i], r[0][i]);
+    }
+
+    branch_counter = _mm256_set1_epi64x(32);
+
+    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        program_execute_reg(&program_list->prog[i], reg, &branch_counter);
+        for (int j = 0; j < 8; ++j) {
+            mem[HASHWX_MEM_SIZE - 1 - 8 * i - j] = reg[j];
+        }
+    }
+
+    branch_counter = _mm256_set1_epi64x(32);
+
+    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        program_execute_mem(&program_list->prog[i], reg, &branch_counter, mem);
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        uint64_t lanes[LANES];
+        _mm256_storeu_si256((__m256i*)lanes, reg[i]);
+        for (int j = 0; j < LANES; ++j) {
+            r[j][i] = lanes[j];
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,147 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include "program.h"
+
+#ifdef HASHWX_PROGRAM_SIMD
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+#else
+#define TARGET_AVX512
+#endif
+
+#define LANES 8
+
+/*
+    Interpreter that executes the same program list for 8 inputs in
+    lock-step. This is the AVX-512 variant of program_exec_avx2.c, which
+    uses native 64-bit multiplications, rotations and opmask registers.
+*/
+
+TARGET_AVX512
+static FORCE_INLINE __m512i load_src(const __m512i r[], const __m512i* mem, uint32_t src) {
+    if (mem == NULL) {
+        return r[src];
+    }
+    /* interleaved index ((r[src] / 8) % 256) * LANES + lane */
+    const __m512i lane = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    __m512i index = _mm512_and_si512(r[src], _mm512_set1_epi64(255 * LANES));
+    index = _mm512_or_si512(index, lane);
+    return _mm512_i64gather_epi64(index, (const void*)mem, 8);
+}
+
+TARGET_AVX512
+static FORCE_INLINE __m512i execute_instr(const instruction* instr, const __m512i r[], const __m512i* mem) {
+    __m512i dst = r[instr->dst];
+    __m512i imm = _mm512_set1_epi64(instr->imm);
+    __m128i count = _mm_cvtsi32_si128(instr->imm);
+    switch (instr->opcode)
+    {
+    case INSTR_MULOR:
+        return _mm512_mullo_epi64(_mm512_or_si512(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_MULXOR:
+        return _mm512_mullo_epi64(_mm512_xor_si512(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_MULADD:
+        return _mm512_mullo_epi64(_mm512_add_epi64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_RMCG:
+        return _mm512_rorv_epi64(_mm512_mullo_epi64(dst, r[instr->src]), imm);
+    case INSTR_XORROR:
+        return _mm512_xor_si512(_mm512_rorv_epi64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_ADDROR:
+        return _mm512_add_epi64(_mm512_rorv_epi64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_SUBROR:
+        return _mm512_sub_epi64(_mm512_rorv_epi64(dst, imm), load_src(r, mem, instr->src));
+    case INSTR_XORASR:
+        return _mm512_xor_si512(_mm512_sra_epi64(dst, count), load_src(r, mem, instr->src));
+    case INSTR_ADDASR:
+        return _mm512_add_epi64(_mm512_sra_epi64(dst, count), load_src(r, mem, instr->src));
+    case INSTR_SUBASR:
+        return _mm512_sub_epi64(_mm512_sra_epi64(dst, count), load_src(r, mem, instr->src));
+    case INSTR_XORLSR:
+        return _mm512_xor_si512(_mm512_srl_epi64(dst, count), load_src(r, mem, instr->src));
+    case INSTR_ADDLSR:
+        return _mm512_add_epi64(_mm512_srl_epi64(dst, count), load_src(r, mem, instr->src));
+    case INSTR_SUBLSR:
+        return _mm512_sub_epi64(_mm512_srl_epi64(dst, count), load_src(r, mem, instr->src));
+    default:
+        UNREACHABLE;
+    }
+}
+
+/* Relies on the fixed program layout, see program_exec_avx2.c */
+TARGET_AVX512
+static FORCE_INLINE void program_execute(const hashwx_program* program, __m512i r[],
+    __m512i* branch_counter, const __m512i* mem) {
+    __mmask8 active = 0xff;
+    __m512i counter = *branch_counter;
+    for (;;) {
+        __m512i flag = execute_instr(&program->code[0], r, mem);
+        r[program->code[0].dst] = _mm512_mask_mov_epi64(r[program->code[0].dst], active, flag);
+        for (int ic = 1; ic < 7; ++ic) {
+            const instruction* instr = &program->code[ic];
+            __m512i value = execute_instr(instr, r, mem);
+            r[instr->dst] = _mm512_mask_mov_epi64(r[instr->dst], active, value);
+        }
+        /* INSTR_BRANCH */
+        __mmask8 taken = _mm512_mask_test_epi64_mask(active, counter, counter);
+        taken = _mm512_mask_testn_epi64_mask(taken, flag, _mm512_set1_epi64(32));
+        if (taken == 0) {
+            break;
+        }
+        counter = _mm512_mask_sub_epi64(counter, taken, counter, _mm512_set1_epi64(1));
+        active = taken;
+    }
+    *branch_counter = counter;
+    const instruction* instr = &program->code[8];
+    r[instr->dst] = execute_instr(instr, r, mem);
+}
+
+TARGET_AVX512
+static void program_execute_reg(const hashwx_program* program, __m512i r[], __m512i* branch_counter) {
+    program_execute(program, r, branch_counter, NULL);
+}
+
+TARGET_AVX512
+static void program_execute_mem(const hashwx_program* program, __m512i r[], __m512i* branch_counter,
+    const __m512i mem[]) {
+    program_execute(program, r, branch_counter, mem);
+}
+
+TARGET_AVX512
+void hashwx_program_list_execute_avx512(const hashwx_program_list* program_list, uint64_t r[][HASHWX_REG_SIZE]) {
+    __m512i reg[HASHWX_REG_SIZE];
+    __m512i mem[HASHWX_MEM_SIZE];
+    __m512i branch_counter;
+
+    for (int i = 0; i < HASHWX_REG_SIZE; ++i) {
+        reg[i] = _mm512_set_epi64(r[7][i], r[6][i], r[5][i], r[4][i], r[3][i], r[2][i], r[1][i], r[0][i]);
+    }
+
+    branch_counter = _mm512_set1_epi64(32);
+
+    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        program_execute_reg(&program_list->prog[i], reg, &branch_counter);
+        for (int j = 0; j < 8; ++j) {
+            mem[HASHWX_MEM_SIZE - 1 - 8 * i - j] = reg[j];
+        }
+    }
+
+    branch_counter = _mm512_set1_epi64(32);
+
+    for (uint32_t i = 0; i < HASHWX_NUM_PROGRAMS; ++i) {
+        program_execute_mem(&program_list->prog[i], reg, &branch_counter, mem);
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        uint64_t lanes[LANES];
+        _mm512_storeu_si512((void*)lanes, reg[i]);
+        for (int j = 0; j < LANES; ++j) {
+            r[j][i] = lanes[j];
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <hashwx.h>
+#include "sha256.h"
+
+struct hashwx_puzzle {
+    hashwx_ctx* ctx;
+    bool has_function;
+    uint32_t attempts;
+    uint64_t window;
+    uint8_t challenge[HASHWX_CHALLENGE_SIZE];
+};
+
+void hashwx_puzzle_seed(const uint8_t challenge[HASHWX_CHALLENGE_SIZE], uint64_t window,
+    uint8_t seed[HASHWX_SEED_SIZE]) {
+    /* seed = sha256(C || window), the window index is encoded in little endian */
+    uint8_t buffer[HASHWX_CHALLENGE_SIZE + 8];
+    memcpy(buffer, challenge, HASHWX_CHALLENGE_SIZE);
+    for (int i = 0; i < 8; ++i) {
+        buffer[HASHWX_CHALLENGE_SIZE + i] = (uint8_t)(window >> (8 * i));
+    }
+    hashwx_sha256(buffer, sizeof(buffer), seed);
+}
+
+hashwx_puzzle* hashwx_puzzle_alloc(hashwx_type type) {
+    hashwx_puzzle* puzzle = malloc(sizeof(hashwx_puzzle));
+    if (puzzle == NULL) {
+        return NULL;
+    }
+    puzzle->ctx = hashwx_alloc(type);
+    if (puzzle->ctx == NULL || puzzle->ctx == HASHWX_NOTSUPP) {
+        free(puzzle);
+        return NULL;
+    }
+    puzzle->has_function = false;
+    return puzzle;
+}
+
+static void puzzle_make(hashwx_puzzle* puzzle, const uint8_t challenge[HASHWX_CHALLENGE_SIZE],
+    uint32_t attempts, uint64_t window) {
+    if (puzzle->has_function && puzzle->window == window && puzzle->attempts == attempts &&
+        memcmp(puzzle->challenge, challenge, HASHWX_CHALLENGE_SIZE) == 0) {
+        return;
+    }
+    uint8_t seed[HASHWX_SEED_SIZE];
+    hashwx_puzzle_seed(challenge, window, seed);
+    hashwx_make(puzzle->ctx, seed);
+    memcpy(puzzle->challenge, challenge, HASHWX_CHALLENGE_SIZE);
+    puzzle->attempts = attempts;
+    puzzle->window = window;
+    puzzle->has_function = true;
+}
+
+int hashwx_puzzle_solve(hashwx_puzzle* puzzle, const uint8_t challenge[HASHWX_CHALLENGE_SIZE],
+    uint64_t target, uint32_t attempts_per_function, uint64_t start_nonce, uint64_t count,
+    uint64_t* found_nonce, uint64_t* found_hash) {
+    assert(puzzle != NULL);
+    assert(challenge != NULL);
+    assert(attempts_per_function > 0);
+    uint64_t nonce = start_nonce;
+    while (count > 0) {
+        uint64_t window = nonce / attempts_per_function;
+        uint64_t window_left = attempts_per_function - nonce % attempts_per_function;
+        uint64_t batch = count < window_left ? count : window_left;
+        puzzle_make(puzzle, challenge, attempts_per_function, window);
+        if (hashwx_search(puzzle->ctx, nonce, (size_t)batch, target, found_nonce, found_hash)) {
+            return 1;
+        }
+        nonce += batch;
+        count -= batch;
+    }
+    return 0;
+}
+
+int hashwx_puzzle_verify(const uint8_t challenge[HASHWX_CHALLENGE_SIZE],
+    uint32_t attempts_per_function, uint64_t nonce, uint64_t target) {
+    assert(challenge != NULL);
+    assert(attempts_per_function > 0);
+    uint8_t seed[HASHWX_SEED_SIZE];
+    hashwx_puzzle_seed(challenge, nonce / attempts_per_function, seed);
+    return hashwx_verify(seed, nonce) < target;
+}
+
+void hashwx_puzzle_free(hashwx_puzzle* puzzle) {
+    if (puzzle != NULL) {
+        hashwx_free(puzzle->ctx);
+        free(puzzle);
+    }
+}
@@ -0,0 +1,170 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <string.h>
+
+#include "sha256.h"
+#include "cpu.h"
+#include "platform.h"
+
+#if defined(HASHWX_CPU_X86) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define HAVE_SHANI
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SHANI __attribute__((target("sha,ssse3,sse4.1")))
+#else
+#define TARGET_SHANI
+#endif
+#endif
+
+#define SHA256_BLOCK_SIZE 64
+
+typedef void compress_func(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+static const uint32_t sha256_init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static FORCE_INLINE uint32_t load32_be(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static FORCE_INLINE void store32_be(uint8_t* p, uint32_t w) {
+    p[0] = (uint8_t)(w >> 24);
+    p[1] = (uint8_t)(w >> 16);
+    p[2] = (uint8_t)(w >> 8);
+    p[3] = (uint8_t)w;
+}
+
+static FORCE_INLINE uint32_t rotr32(uint32_t a, unsigned int b) {
+    return (a >> b) | (a << (32 - b));
+}
+
+static void compress_portable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    for (; blocks > 0; --blocks, data += SHA256_BLOCK_SIZE) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = load32_be(&data[4 * i]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+            uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef HAVE_SHANI
+
+/* SHA-NI implementation, processes 4 rounds per iteration */
+TARGET_SHANI
+static void compress_shani(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_loadu_si128((const __m128i*)&state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i*)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xb1); /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1b); /* EFGH */
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0); /* CDGH */
+
+    for (; blocks > 0; --blocks, data += SHA256_BLOCK_SIZE) {
+        __m128i abef = state0;
+        __m128i cdgh = state1;
+        __m128i msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&data[16 * i]), bswap);
+        }
+        for (int i = 0; i < 16; ++i) {
+            __m128i k = _mm_loadu_si128((const __m128i*)&sha256_k[4 * i]);
+            __m128i wk = _mm_add_epi32(msg[i % 4], k);
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            wk = _mm_shuffle_epi32(wk, 0x0e);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+            if (i < 12) {
+                /* message schedule for rounds 4*(i+4) to 4*(i+4)+3 */
+                __m128i w = _mm_sha256msg1_epu32(msg[i % 4], msg[(i + 1) % 4]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(msg[(i + 3) % 4], msg[(i + 2) % 4], 4));
+                msg[i % 4] = _mm_sha256msg2_epu32(w, msg[(i + 3) % 4]);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b); /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xb1); /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0); /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8); /* ABEF */
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+#endif
+
+static compress_func* select_compress(void) {
+#ifdef HAVE_SHANI
+    const uint32_t shani = HASHWX_CPU_SSSE3 | HASHWX_CPU_SSE41 | HASHWX_CPU_SHA;
+    if ((hashwx_cpu_features() & shani) == shani) {
+        return &compress_shani;
+    }
+#endif
+    return &compress_portable;
+}
+
+void hashwx_sha256(const void* data, size_t size, uint8_t out[HASHWX_SHA256_SIZE]) {
+    compress_func* compress = select_compress();
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t state[8];
+    uint8_t tail[2 * SHA256_BLOCK_SIZE];
+    memcpy(state, sha256_init, sizeof(state));
+    size_t blocks = size / SHA256_BLOCK_SIZE;
+    if (blocks > 0) {
+        compress(state, p, blocks);
+    }
+    size_t rest = size % SHA256_BLOCK_SIZE;
+    size_t tail_size = rest < SHA256_BLOCK_SIZE - 8 ? SHA256_BLOCK_SIZE : 2 * SHA256_BLOCK_SIZE;
+    memset(tail, 0, tail_size);
+    if (rest > 0) {
+        memcpy(tail, p + blocks * SHA256_BLOCK_SIZE, rest);
+    }
+    tail[rest] = 0x80;
+    uint64_t bits = (uint64_t)size * 8;
+    store32_be(&tail[tail_size - 8], (uint32_t)(bits >> 32));
+    store32_be(&tail[tail_size - 4], (uint32_t)bits);
+    compress(state, tail, tail_size / SHA256_BLOCK_SIZE);
+    for (int i = 0; i < 8; ++i) {
+        store32_be(&out[4 * i], state[i]);
+    }
+}
@@ -0,0 +1,23 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <hashwx.h>
+
+#define HASHWX_SHA256_SIZE 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HASHWX_PRIVATE void hashwx_sha256(const void* data, size_t size, uint8_t out[HASHWX_SHA256_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
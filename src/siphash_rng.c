@@ -6,10 +6,10 @@
 void hashwx_rng_init(siphash_rng* gen, const siphash_key* key, const uint64_t salt) {
     uint64_t k0 = key->k0;
     uint64_t k1 = key->k1;
-    uint64_t v0 = UINT64_C(0x736f6d6570736575) ^ k0;
-    uint64_t v1 = UINT64_C(0x646f72616e646f6d) ^ k1;
-    uint64_t v2 = UINT64_C(0x6c7967656e657261) ^ k0;
-    uint64_t v3 = UINT64_C(0x7465646279746573) ^ k1;
+    uint64_t v0 = SIPHASH_C0 ^ k0;
+    uint64_t v1 = SIPHASH_C1 ^ k1;
+    uint64_t v2 = SIPHASH_C2 ^ k0;
+    uint64_t v3 = SIPHASH_C3 ^ k1;
 
     v3 ^= salt;
 
@@ -17,6 +17,12 @@
     v1 ^= v2; v3 ^= v0; v2 = ROTL(v2, 32);   \
   } while (0)
 
+/* initial siphash state, xored with the key */
+#define SIPHASH_C0 UINT64_C(0x736f6d6570736575)
+#define SIPHASH_C1 UINT64_C(0x646f72616e646f6d)
+#define SIPHASH_C2 UINT64_C(0x6c7967656e657261)
+#define SIPHASH_C3 UINT64_C(0x7465646279746573)
+
 typedef struct siphash_key {
     uint64_t k0, k1;
 } siphash_key;
@@ -0,0 +1,408 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include "siphash_simd.h"
+#include "cpu.h"
+#include "platform.h"
+
+#if defined(HASHWX_CPU_X86) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define HAVE_SIPHASH_X86
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define HAVE_SIPHASH_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+    SIPROUND with all lanes in vectors, see siphash_rng.h. SipHash is a long
+    dependency chain and vector rotations are slower than scalar ones, so
+    except for AVX-512, each function processes two independent vectors.
+*/
+#define SIPROUND_SIMD(v0, v1, v2, v3, ADD, XOR, ROTL, ROTL16, ROTL32) \
+  do { \
+    v0 = ADD(v0, v1); v2 = ADD(v2, v3); v1 = ROTL(v1, 13);   \
+    v3 = ROTL16(v3); v1 = XOR(v1, v0); v3 = XOR(v3, v2);     \
+    v0 = ROTL32(v0); v2 = ADD(v2, v1); v0 = ADD(v0, v3);     \
+    v1 = ROTL(v1, 17); v3 = ROTL(v3, 21);                    \
+    v1 = XOR(v1, v2); v3 = XOR(v3, v0); v2 = ROTL32(v2);     \
+  } while (0)
+
+#if defined(HAVE_SIPHASH_X86) || defined(HAVE_SIPHASH_NEON)
+
+/* lanes[i * n + j] is register i of input j */
+static FORCE_INLINE void scatter_registers(const uint64_t* lanes, int n, uint64_t r[][HASHWX_REG_SIZE]) {
+    for (int i = 0; i < HASHWX_REG_SIZE; ++i) {
+        for (int j = 0; j < n; ++j) {
+            r[j][i] = lanes[i * n + j];
+        }
+    }
+}
+
+#endif
+
+#ifdef HAVE_SIPHASH_X86
+
+/* SSE2 implementation, 2 vectors of 2 lanes */
+
+#define SSE2_ROTL(x, b) _mm_or_si128(_mm_slli_epi64(x, b), _mm_srli_epi64(x, 64 - (b)))
+#define SSE2_ROTL16(x) _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0x93), 0x93)
+#define SSE2_ROTL32(x) _mm_shuffle_epi32(x, 0xb1)
+#define SSE2_SIPROUND(v0, v1, v2, v3) \
+    SIPROUND_SIMD(v0, v1, v2, v3, _mm_add_epi64, _mm_xor_si128, SSE2_ROTL, SSE2_ROTL16, SSE2_ROTL32)
+
+static void siphash_init_sse2(const siphash_key* key, const uint64_t input[], uint64_t r[][HASHWX_REG_SIZE]) {
+    uint64_t lanes[HASHWX_REG_SIZE][4];
+    const __m128i k0 = _mm_set1_epi64x(key->k0);
+    const __m128i k1 = _mm_set1_epi64x(key->k1);
+    __m128i v0[2], v1[2], v2[2], v3[2];
+    for (int h = 0; h < 2; ++h) {
+        const __m128i salt = _mm_loadu_si128((const __m128i*)&input[2 * h]);
+        v0[h] = _mm_xor_si128(_mm_set1_epi64x(SIPHASH_C0), k0);
+        v1[h] = _mm_xor_si128(_mm_set1_epi64x(SIPHASH_C1), k1);
+        v2[h] = _mm_xor_si128(_mm_set1_epi64x(SIPHASH_C2), k0);
+        v3[h] = _mm_xor_si128(_mm_set1_epi64x(SIPHASH_C3), k1);
+
+        /* hashwx_rng_init */
+        v3[h] = _mm_xor_si128(v3[h], salt);
+        SSE2_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        v0[h] = _mm_xor_si128(v0[h], salt);
+        v2[h] = _mm_xor_si128(v2[h], _mm_set1_epi64x(0xbb));
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int h = 0; h < 2; ++h) {
+            SSE2_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        }
+    }
+    for (int h = 0; h < 2; ++h) {
+        _mm_storeu_si128((__m128i*)&lanes[0][2 * h], v3[h]);
+        _mm_storeu_si128((__m128i*)&lanes[1][2 * h], v2[h]);
+        _mm_storeu_si128((__m128i*)&lanes[2][2 * h], v1[h]);
+        _mm_storeu_si128((__m128i*)&lanes[3][2 * h], v0[h]);
+
+        /* hashwx_rng_mix */
+        v0[h] = _mm_xor_si128(v0[h], k0);
+        v1[h] = _mm_xor_si128(v1[h], k1);
+        v2[h] = _mm_xor_si128(v2[h], k0);
+        v3[h] = _mm_xor_si128(v3[h], k1);
+    }
+    for (int i = 0; i < 4; ++i) {
+        for (int h = 0; h < 2; ++h) {
+            SSE2_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        }
+    }
+    /* R8 = 3 mod 8, R9 = 5 mod 8 */
+    const __m128i mask = _mm_set1_epi64x(-8);
+    for (int h = 0; h < 2; ++h) {
+        _mm_storeu_si128((__m128i*)&lanes[4][2 * h], v3[h]);
+        _mm_storeu_si128((__m128i*)&lanes[5][2 * h], v2[h]);
+        _mm_storeu_si128((__m128i*)&lanes[6][2 * h], v1[h]);
+        _mm_storeu_si128((__m128i*)&lanes[7][2 * h], v0[h]);
+        _mm_storeu_si128((__m128i*)&lanes[8][2 * h], _mm_or_si128(_mm_and_si128(v3[h], mask), _mm_set1_epi64x(3)));
+        _mm_storeu_si128((__m128i*)&lanes[9][2 * h], _mm_or_si128(_mm_and_si128(v0[h], mask), _mm_set1_epi64x(5)));
+    }
+
+    scatter_registers(&lanes[0][0], 4, r);
+}
+
+static void siphash_final_sse2(uint64_t r[][HASHWX_REG_SIZE], uint64_t out[]) {
+    __m128i v[2][HASHWX_REG_SIZE];
+    for (int h = 0; h < 2; ++h) {
+        for (int i = 0; i < HASHWX_REG_SIZE; ++i) {
+            v[h][i] = _mm_set_epi64x(r[2 * h + 1][i], r[2 * h][i]);
+        }
+    }
+    for (int h = 0; h < 2; ++h) {
+        SSE2_SIPROUND(v[h][0], v[h][1], v[h][2], v[h][3]);
+        SSE2_SIPROUND(v[h][4], v[h][5], v[h][6], v[h][7]);
+    }
+    for (int h = 0; h < 2; ++h) {
+        _mm_storeu_si128((__m128i*)&out[2 * h], _mm_xor_si128(_mm_xor_si128(v[h][3], v[h][7]), v[h][9]));
+    }
+}
+
+/* AVX2 implementation, 2 vectors of 4 lanes */
+
+#define AVX2_ROTL(x, b) _mm256_or_si256(_mm256_slli_epi64(x, b), _mm256_srli_epi64(x, 64 - (b)))
+#define AVX2_ROTL16(x) _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0x93), 0x93)
+#define AVX2_ROTL32(x) _mm256_shuffle_epi32(x, 0xb1)
+#define AVX2_SIPROUND(v0, v1, v2, v3) \
+    SIPROUND_SIMD(v0, v1, v2, v3, _mm256_add_epi64, _mm256_xor_si256, AVX2_ROTL, AVX2_ROTL16, AVX2_ROTL32)
+
+TARGET_AVX2
+static void siphash_init_avx2(const siphash_key* key, const uint64_t input[], uint64_t r[][HASHWX_REG_SIZE]) {
+    uint64_t lanes[HASHWX_REG_SIZE][8];
+    const __m256i k0 = _mm256_set1_epi64x(key->k0);
+    const __m256i k1 = _mm256_set1_epi64x(key->k1);
+    __m256i v0[2], v1[2], v2[2], v3[2];
+    for (int h = 0; h < 2; ++h) {
+        const __m256i salt = _mm256_loadu_si256((const __m256i*)&input[4 * h]);
+        v0[h] = _mm256_xor_si256(_mm256_set1_epi64x(SIPHASH_C0), k0);
+        v1[h] = _mm256_xor_si256(_mm256_set1_epi64x(SIPHASH_C1), k1);
+        v2[h] = _mm256_xor_si256(_mm256_set1_epi64x(SIPHASH_C2), k0);
+        v3[h] = _mm256_xor_si256(_mm256_set1_epi64x(SIPHASH_C3), k1);
+
+        /* hashwx_rng_init */
+        v3[h] = _mm256_xor_si256(v3[h], salt);
+        AVX2_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        v0[h] = _mm256_xor_si256(v0[h], salt);
+        v2[h] = _mm256_xor_si256(v2[h], _mm256_set1_epi64x(0xbb));
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int h = 0; h < 2; ++h) {
+            AVX2_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        }
+    }
+    for (int h = 0; h < 2; ++h) {
+        _mm256_storeu_si256((__m256i*)&lanes[0][4 * h], v3[h]);
+        _mm256_storeu_si256((__m256i*)&lanes[1][4 * h], v2[h]);
+        _mm256_storeu_si256((__m256i*)&lanes[2][4 * h], v1[h]);
+        _mm256_storeu_si256((__m256i*)&lanes[3][4 * h], v0[h]);
+
+        /* hashwx_rng_mix */
+        v0[h] = _mm256_xor_si256(v0[h], k0);
+        v1[h] = _mm256_xor_si256(v1[h], k1);
+        v2[h] = _mm256_xor_si256(v2[h], k0);
+        v3[h] = _mm256_xor_si256(v3[h], k1);
+    }
+    for (int i = 0; i < 4; ++i) {
+        for (int h = 0; h < 2; ++h) {
+            AVX2_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        }
+    }
+    /* R8 = 3 mod 8, R9 = 5 mod 8 */
+    const __m256i mask = _mm256_set1_epi64x(-8);
+    for (int h = 0; h < 2; ++h) {
+        _mm256_storeu_si256((__m256i*)&lanes[4][4 * h], v3[h]);
+        _mm256_storeu_si256((__m256i*)&lanes[5][4 * h], v2[h]);
+        _mm256_storeu_si256((__m256i*)&lanes[6][4 * h], v1[h]);
+        _mm256_storeu_si256((__m256i*)&lanes[7][4 * h], v0[h]);
+        _mm256_storeu_si256((__m256i*)&lanes[8][4 * h], _mm256_or_si256(_mm256_and_si256(v3[h], mask), _mm256_set1_epi64x(3)));
+        _mm256_storeu_si256((__m256i*)&lanes[9][4 * h], _mm256_or_si256(_mm256_and_si256(v0[h], mask), _mm256_set1_epi64x(5)));
+    }
+
+    scatter_registers(&lanes[0][0], 8, r);
+}
+
+/* registers R0-R7 and R9 are gathered from r[0..3] */
+TARGET_AVX2
+static FORCE_INLINE __m256i final_avx2(uint64_t r[][HASHWX_REG_SIZE]) {
+    const long long* base = (const long long*)&r[0][0];
+    const __m256i index = _mm256_set_epi64x(3 * HASHWX_REG_SIZE, 2 * HASHWX_REG_SIZE, HASHWX_REG_SIZE, 0);
+    __m256i v0 = _mm256_i64gather_epi64(base + 0, index, 8);
+    __m256i v1 = _mm256_i64gather_epi64(base + 1, index, 8);
+    __m256i v2 = _mm256_i64gather_epi64(base + 2, index, 8);
+    __m256i v3 = _mm256_i64gather_epi64(base + 3, index, 8);
+    __m256i v4 = _mm256_i64gather_epi64(base + 4, index, 8);
+    __m256i v5 = _mm256_i64gather_epi64(base + 5, index, 8);
+    __m256i v6 = _mm256_i64gather_epi64(base + 6, index, 8);
+    __m256i v7 = _mm256_i64gather_epi64(base + 7, index, 8);
+    __m256i v9 = _mm256_i64gather_epi64(base + 9, index, 8);
+    AVX2_SIPROUND(v0, v1, v2, v3);
+    AVX2_SIPROUND(v4, v5, v6, v7);
+    return _mm256_xor_si256(_mm256_xor_si256(v3, v7), v9);
+}
+
+TARGET_AVX2
+static void siphash_final_avx2(uint64_t r[][HASHWX_REG_SIZE], uint64_t out[]) {
+    __m256i lo = final_avx2(&r[0]);
+    __m256i hi = final_avx2(&r[4]);
+    _mm256_storeu_si256((__m256i*)&out[0], lo);
+    _mm256_storeu_si256((__m256i*)&out[4], hi);
+}
+
+/* AVX-512 implementation, 8 lanes */
+
+#define AVX512_ROTL16(x) _mm512_rol_epi64(x, 16)
+#define AVX512_ROTL32(x) _mm512_rol_epi64(x, 32)
+#define AVX512_SIPROUND(v0, v1, v2, v3) \
+    SIPROUND_SIMD(v0, v1, v2, v3, _mm512_add_epi64, _mm512_xor_si512, _mm512_rol_epi64, AVX512_ROTL16, AVX512_ROTL32)
+
+TARGET_AVX512
+static void siphash_init_avx512(const siphash_key* key, const uint64_t input[], uint64_t r[][HASHWX_REG_SIZE]) {
+    /* registers are scattered to r[0..7] */
+    uint64_t* base = &r[0][0];
+    const __m512i index = _mm512_set_epi64(7 * HASHWX_REG_SIZE, 6 * HASHWX_REG_SIZE,
+        5 * HASHWX_REG_SIZE, 4 * HASHWX_REG_SIZE, 3 * HASHWX_REG_SIZE, 2 * HASHWX_REG_SIZE,
+        HASHWX_REG_SIZE, 0);
+    const __m512i k0 = _mm512_set1_epi64(key->k0);
+    const __m512i k1 = _mm512_set1_epi64(key->k1);
+    const __m512i salt = _mm512_loadu_si512((const void*)input);
+    __m512i v0 = _mm512_xor_si512(_mm512_set1_epi64(SIPHASH_C0), k0);
+    __m512i v1 = _mm512_xor_si512(_mm512_set1_epi64(SIPHASH_C1), k1);
+    __m512i v2 = _mm512_xor_si512(_mm512_set1_epi64(SIPHASH_C2), k0);
+    __m512i v3 = _mm512_xor_si512(_mm512_set1_epi64(SIPHASH_C3), k1);
+
+    /* hashwx_rng_init */
+    v3 = _mm512_xor_si512(v3, salt);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    v0 = _mm512_xor_si512(v0, salt);
+    v2 = _mm512_xor_si512(v2, _mm512_set1_epi64(0xbb));
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    _mm512_i64scatter_epi64((void*)(base + 0), index, v3, 8);
+    _mm512_i64scatter_epi64((void*)(base + 1), index, v2, 8);
+    _mm512_i64scatter_epi64((void*)(base + 2), index, v1, 8);
+    _mm512_i64scatter_epi64((void*)(base + 3), index, v0, 8);
+
+    /* hashwx_rng_mix */
+    v0 = _mm512_xor_si512(v0, k0);
+    v1 = _mm512_xor_si512(v1, k1);
+    v2 = _mm512_xor_si512(v2, k0);
+    v3 = _mm512_xor_si512(v3, k1);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    _mm512_i64scatter_epi64((void*)(base + 4), index, v3, 8);
+    _mm512_i64scatter_epi64((void*)(base + 5), index, v2, 8);
+    _mm512_i64scatter_epi64((void*)(base + 6), index, v1, 8);
+    _mm512_i64scatter_epi64((void*)(base + 7), index, v0, 8);
+
+    /* R8 = 3 mod 8, R9 = 5 mod 8 */
+    const __m512i mask = _mm512_set1_epi64(-8);
+    _mm512_i64scatter_epi64((void*)(base + 8), index, _mm512_or_si512(_mm512_and_si512(v3, mask), _mm512_set1_epi64(3)), 8);
+    _mm512_i64scatter_epi64((void*)(base + 9), index, _mm512_or_si512(_mm512_and_si512(v0, mask), _mm512_set1_epi64(5)), 8);
+}
+
+TARGET_AVX512
+static void siphash_final_avx512(uint64_t r[][HASHWX_REG_SIZE], uint64_t out[]) {
+    /* registers R0-R7 and R9 are gathered from r[0..7] */
+    const uint64_t* base = &r[0][0];
+    const __m512i index = _mm512_set_epi64(7 * HASHWX_REG_SIZE, 6 * HASHWX_REG_SIZE,
+        5 * HASHWX_REG_SIZE, 4 * HASHWX_REG_SIZE, 3 * HASHWX_REG_SIZE, 2 * HASHWX_REG_SIZE,
+        HASHWX_REG_SIZE, 0);
+    __m512i v0 = _mm512_i64gather_epi64(index, (const void*)(base + 0), 8);
+    __m512i v1 = _mm512_i64gather_epi64(index, (const void*)(base + 1), 8);
+    __m512i v2 = _mm512_i64gather_epi64(index, (const void*)(base + 2), 8);
+    __m512i v3 = _mm512_i64gather_epi64(index, (const void*)(base + 3), 8);
+    __m512i v4 = _mm512_i64gather_epi64(index, (const void*)(base + 4), 8);
+    __m512i v5 = _mm512_i64gather_epi64(index, (const void*)(base + 5), 8);
+    __m512i v6 = _mm512_i64gather_epi64(index, (const void*)(base + 6), 8);
+    __m512i v7 = _mm512_i64gather_epi64(index, (const void*)(base + 7), 8);
+    __m512i v9 = _mm512_i64gather_epi64(index, (const void*)(base + 9), 8);
+    AVX512_SIPROUND(v0, v1, v2, v3);
+    AVX512_SIPROUND(v4, v5, v6, v7);
+    _mm512_storeu_si512((void*)out, _mm512_xor_si512(_mm512_xor_si512(v3, v7), v9));
+}
+
+#endif
+
+#ifdef HAVE_SIPHASH_NEON
+
+/* NEON implementation, 2 vectors of 2 lanes */
+
+#define NEON_ROTL(x, b) vsriq_n_u64(vshlq_n_u64(x, b), x, 64 - (b))
+#define NEON_ROTL16(x) NEON_ROTL(x, 16)
+#define NEON_ROTL32(x) vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(x)))
+#define NEON_SIPROUND(v0, v1, v2, v3) \
+    SIPROUND_SIMD(v0, v1, v2, v3, vaddq_u64, veorq_u64, NEON_ROTL, NEON_ROTL16, NEON_ROTL32)
+
+static void siphash_init_neon(const siphash_key* key, const uint64_t input[], uint64_t r[][HASHWX_REG_SIZE]) {
+    uint64_t lanes[HASHWX_REG_SIZE][4];
+    const uint64x2_t k0 = vdupq_n_u64(key->k0);
+    const uint64x2_t k1 = vdupq_n_u64(key->k1);
+    uint64x2_t v0[2], v1[2], v2[2], v3[2];
+    for (int h = 0; h < 2; ++h) {
+        const uint64x2_t salt = vld1q_u64(&input[2 * h]);
+        v0[h] = veorq_u64(vdupq_n_u64(SIPHASH_C0), k0);
+        v1[h] = veorq_u64(vdupq_n_u64(SIPHASH_C1), k1);
+        v2[h] = veorq_u64(vdupq_n_u64(SIPHASH_C2), k0);
+        v3[h] = veorq_u64(vdupq_n_u64(SIPHASH_C3), k1);
+
+        /* hashwx_rng_init */
+        v3[h] = veorq_u64(v3[h], salt);
+        NEON_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        v0[h] = veorq_u64(v0[h], salt);
+        v2[h] = veorq_u64(v2[h], vdupq_n_u64(0xbb));
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int h = 0; h < 2; ++h) {
+            NEON_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        }
+    }
+    for (int h = 0; h < 2; ++h) {
+        vst1q_u64(&lanes[0][2 * h], v3[h]);
+        vst1q_u64(&lanes[1][2 * h], v2[h]);
+        vst1q_u64(&lanes[2][2 * h], v1[h]);
+        vst1q_u64(&lanes[3][2 * h], v0[h]);
+
+        /* hashwx_rng_mix */
+        v0[h] = veorq_u64(v0[h], k0);
+        v1[h] = veorq_u64(v1[h], k1);
+        v2[h] = veorq_u64(v2[h], k0);
+        v3[h] = veorq_u64(v3[h], k1);
+    }
+    for (int i = 0; i < 4; ++i) {
+        for (int h = 0; h < 2; ++h) {
+            NEON_SIPROUND(v0[h], v1[h], v2[h], v3[h]);
+        }
+    }
+    /* R8 = 3 mod 8, R9 = 5 mod 8 */
+    const uint64x2_t mask = vdupq_n_u64(~UINT64_C(7));
+    for (int h = 0; h < 2; ++h) {
+        vst1q_u64(&lanes[4][2 * h], v3[h]);
+        vst1q_u64(&lanes[5][2 * h], v2[h]);
+        vst1q_u64(&lanes[6][2 * h], v1[h]);
+        vst1q_u64(&lanes[7][2 * h], v0[h]);
+        vst1q_u64(&lanes[8][2 * h], vorrq_u64(vandq_u64(v3[h], mask), vdupq_n_u64(3)));
+        vst1q_u64(&lanes[9][2 * h], vorrq_u64(vandq_u64(v0[h], mask), vdupq_n_u64(5)));
+    }
+
+    scatter_registers(&lanes[0][0], 4, r);
+}
+
+static void siphash_final_neon(uint64_t r[][HASHWX_REG_SIZE], uint64_t out[]) {
+    uint64x2_t v[2][HASHWX_REG_SIZE];
+    for (int h = 0; h < 2; ++h) {
+        for (int i = 0; i < HASHWX_REG_SIZE; ++i) {
+            v[h][i] = vcombine_u64(vcreate_u64(r[2 * h][i]), vcreate_u64(r[2 * h + 1][i]));
+        }
+    }
+    for (int h = 0; h < 2; ++h) {
+        NEON_SIPROUND(v[h][0], v[h][1], v[h][2], v[h][3]);
+        NEON_SIPROUND(v[h][4], v[h][5], v[h][6], v[h][7]);
+    }
+    for (int h = 0; h < 2; ++h) {
+        vst1q_u64(&out[2 * h], veorq_u64(veorq_u64(v[h][3], v[h][7]), v[h][9]));
+    }
+}
+
+#endif
+
+int hashwx_siphash_simd(siphash_init_func** init, siphash_final_func** final) {
+#if defined(HAVE_SIPHASH_X86)
+    uint32_t features = hashwx_cpu_features();
+    if (features & HASHWX_CPU_AVX512) {
+        *init = &siphash_init_avx512;
+        *final = &siphash_final_avx512;
+        return 8;
+    }
+    if (features & HASHWX_CPU_AVX2) {
+        *init = &siphash_init_avx2;
+        *final = &siphash_final_avx2;
+        return 8;
+    }
+    /* SSE2 is part of x86-64 */
+    *init = &siphash_init_sse2;
+    *final = &siphash_final_sse2;
+    return 4;
+#elif defined(HAVE_SIPHASH_NEON)
+    *init = &siphash_init_neon;
+    *final = &siphash_final_neon;
+    return 4;
+#else
+    (void)init;
+    (void)final;
+    return 0;
+#endif
+}
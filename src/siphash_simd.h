@@ -0,0 +1,40 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef SIPHASH_SIMD_H
+#define SIPHASH_SIMD_H
+
+#include <stdint.h>
+#include <hashwx.h>
+#include "siphash_rng.h"
+#include "program.h"
+
+/*
+    Calculates the initial registers of several inputs at once. This is
+    equivalent to calling hashwx_rng_init and 8x hashwx_rng_next for each
+    input and setting R8 and R9.
+*/
+typedef void siphash_init_func(const siphash_key* key, const uint64_t input[], uint64_t r[][HASHWX_REG_SIZE]);
+
+/*
+    Calculates the final hashes of several inputs at once
+    (2 SIPROUNDs and out = R3 ^ R7 ^ R9).
+*/
+typedef void siphash_final_func(uint64_t r[][HASHWX_REG_SIZE], uint64_t out[]);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Selects the fastest SIMD implementation supported by the CPU.
+    Returns the number of inputs processed per call or 0 if there is
+    no SIMD implementation.
+*/
+HASHWX_PRIVATE int hashwx_siphash_simd(siphash_init_func** init, siphash_final_func** final);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,250 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <hashwx.h>
+#include "worker_pool.h"
+
+/*
+    Work is distributed in units of puzzle windows (attempts_per_function
+    nonces that share one function). Each worker starts with a contiguous
+    block of windows and takes windows from the front of its block. A worker
+    that runs out of work steals the back half of the block of another worker.
+*/
+
+typedef struct solver_worker {
+    hashwx_puzzle* puzzle;
+    hashwx_mutex lock;
+    uint64_t next;
+    uint64_t end;
+} solver_worker;
+
+struct hashwx_solver {
+    hashwx_worker_pool* pool;
+    solver_worker* workers;
+    int num_workers;
+    hashwx_mutex call_lock;
+    hashwx_mutex lock;
+    /* state of the current hashwx_solver_run call, protected by lock */
+    bool stop;
+    bool cancelled;
+    bool found;
+    uint64_t found_nonce;
+    uint64_t found_hash;
+    uint64_t hashes;
+    /* parameters of the current hashwx_solver_run call */
+    const uint8_t* challenge;
+    uint64_t target;
+    uint32_t attempts;
+    uint64_t start_nonce;
+    uint64_t end_nonce;
+    uint64_t first_window;
+    hashwx_progress_func* progress;
+    void* user_data;
+};
+
+static bool take_window(solver_worker* worker, uint64_t* window) {
+    bool taken = false;
+    hashwx_mutex_lock(&worker->lock);
+    if (worker->next < worker->end) {
+        *window = worker->next++;
+        taken = true;
+    }
+    hashwx_mutex_unlock(&worker->lock);
+    return taken;
+}
+
+static bool steal_windows(hashwx_solver* solver, int thief_id) {
+    solver_worker* thief = &solver->workers[thief_id];
+    for (int i = 1; i < solver->num_workers; ++i) {
+        solver_worker* victim = &solver->workers[(thief_id + i) % solver->num_workers];
+        uint64_t next = 0, end = 0;
+        hashwx_mutex_lock(&victim->lock);
+        if (victim->next < victim->end) {
+            /* take the back half, rounded up */
+            end = victim->end;
+            next = end - (end - victim->next + 1) / 2;
+            victim->end = next;
+        }
+        hashwx_mutex_unlock(&victim->lock);
+        if (next < end) {
+            hashwx_mutex_lock(&thief->lock);
+            thief->next = next;
+            thief->end = end;
+            hashwx_mutex_unlock(&thief->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void solver_worker_main(void* job, int worker_id) {
+    hashwx_solver* solver = (hashwx_solver*)job;
+    solver_worker* worker = &solver->workers[worker_id];
+    uint64_t window;
+    for (;;) {
+        if (!take_window(worker, &window) && !(steal_windows(solver, worker_id) && take_window(worker, &window))) {
+            break;
+        }
+        uint64_t window_start = (solver->first_window + window) * solver->attempts;
+        uint64_t begin = window_start > solver->start_nonce ? window_start : solver->start_nonce;
+        uint64_t end = window_start + solver->attempts;
+        if (end > solver->end_nonce || end < window_start) {
+            end = solver->end_nonce;
+        }
+        uint64_t nonce, hash;
+        int found = hashwx_puzzle_solve(worker->puzzle, solver->challenge, solver->target,
+            solver->attempts, begin, end - begin, &nonce, &hash);
+        bool stop;
+        uint64_t hashes;
+        hashwx_mutex_lock(&solver->lock);
+        solver->hashes += found ? nonce - begin + 1 : end - begin;
+        if (found && !solver->found) {
+            solver->found = true;
+            solver->found_nonce = nonce;
+            solver->found_hash = hash;
+            solver->stop = true;
+        }
+        stop = solver->stop;
+        hashes = solver->hashes;
+        hashwx_mutex_unlock(&solver->lock);
+        if (stop) {
+            break;
+        }
+        if (worker_id == 0 && solver->progress != NULL && solver->progress(solver->user_data, hashes)) {
+            hashwx_solver_cancel(solver);
+            break;
+        }
+    }
+}
+
+hashwx_solver* hashwx_solver_alloc(hashwx_type type, int threads) {
+    hashwx_solver* solver = malloc(sizeof(hashwx_solver));
+    if (solver == NULL) {
+        return NULL;
+    }
+    solver->workers = NULL;
+    solver->num_workers = 0;
+    solver->pool = hashwx_pool_alloc(threads);
+    if (solver->pool == NULL) {
+        goto failure;
+    }
+    int workers = hashwx_pool_size(solver->pool);
+    solver->workers = malloc(sizeof(solver_worker) * workers);
+    if (solver->workers == NULL) {
+        goto failure;
+    }
+    for (int i = 0; i < workers; ++i) {
+        solver_worker* worker = &solver->workers[i];
+        if (!hashwx_mutex_init(&worker->lock)) {
+            goto failure;
+        }
+        worker->puzzle = hashwx_puzzle_alloc(type);
+        if (worker->puzzle == NULL) {
+            hashwx_mutex_destroy(&worker->lock);
+            goto failure;
+        }
+        solver->num_workers++;
+    }
+    if (!hashwx_mutex_init(&solver->call_lock)) {
+        goto failure;
+    }
+    if (!hashwx_mutex_init(&solver->lock)) {
+        hashwx_mutex_destroy(&solver->call_lock);
+        goto failure;
+    }
+    return solver;
+failure:
+    for (int i = 0; i < solver->num_workers; ++i) {
+        hashwx_puzzle_free(solver->workers[i].puzzle);
+        hashwx_mutex_destroy(&solver->workers[i].lock);
+    }
+    free(solver->workers);
+    hashwx_pool_free(solver->pool);
+    free(solver);
+    return NULL;
+}
+
+int hashwx_solver_run(hashwx_solver* solver, const uint8_t challenge[HASHWX_CHALLENGE_SIZE],
+    uint64_t target, uint32_t attempts_per_function, uint64_t start_nonce, uint64_t count,
+    hashwx_progress_func* progress, void* user_data, uint64_t* found_nonce, uint64_t* found_hash) {
+    assert(solver != NULL);
+    assert(challenge != NULL);
+    assert(attempts_per_function > 0);
+    if (count > UINT64_MAX - start_nonce) {
+        count = UINT64_MAX - start_nonce;
+    }
+    hashwx_mutex_lock(&solver->call_lock);
+    solver->challenge = challenge;
+    solver->target = target;
+    solver->attempts = attempts_per_function;
+    solver->start_nonce = start_nonce;
+    solver->end_nonce = start_nonce + count;
+    solver->first_window = start_nonce / attempts_per_function;
+    solver->progress = progress;
+    solver->user_data = user_data;
+    uint64_t num_windows = 0;
+    if (count > 0) {
+        num_windows = (solver->end_nonce - 1) / attempts_per_function - solver->first_window + 1;
+    }
+    /* split the windows evenly between the workers */
+    uint64_t share = num_windows / solver->num_workers;
+    uint64_t extra = num_windows % solver->num_workers;
+    uint64_t next = 0;
+    for (int i = 0; i < solver->num_workers; ++i) {
+        solver_worker* worker = &solver->workers[i];
+        worker->next = next;
+        next += share + ((uint64_t)i < extra);
+        worker->end = next;
+    }
+    hashwx_mutex_lock(&solver->lock);
+    solver->stop = false;
+    solver->cancelled = false;
+    solver->found = false;
+    solver->hashes = 0;
+    hashwx_mutex_unlock(&solver->lock);
+    hashwx_pool_run(solver->pool, &solver_worker_main, solver);
+    int result = 0;
+    if (solver->found) {
+        if (found_nonce != NULL) {
+            *found_nonce = solver->found_nonce;
+        }
+        if (found_hash != NULL) {
+            *found_hash = solver->found_hash;
+        }
+        result = 1;
+    }
+    else if (solver->cancelled) {
+        result = -1;
+    }
+    hashwx_mutex_unlock(&solver->call_lock);
+    return result;
+}
+
+void hashwx_solver_cancel(hashwx_solver* solver) {
+    assert(solver != NULL);
+    hashwx_mutex_lock(&solver->lock);
+    if (!solver->stop) {
+        solver->stop = true;
+        solver->cancelled = true;
+    }
+    hashwx_mutex_unlock(&solver->lock);
+}
+
+void hashwx_solver_free(hashwx_solver* solver) {
+    if (solver == NULL) {
+        return;
+    }
+    hashwx_pool_free(solver->pool);
+    for (int i = 0; i < solver->num_workers; ++i) {
+        hashwx_puzzle_free(solver->workers[i].puzzle);
+        hashwx_mutex_destroy(&solver->workers[i].lock);
+    }
+    free(solver->workers);
+    hashwx_mutex_destroy(&solver->lock);
+    hashwx_mutex_destroy(&solver->call_lock);
+    free(solver);
+}
@@ -0,0 +1,269 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include "stats.h"
+#include "context.h"
+
+#ifdef HASHWX_STATS
+
+#include "worker_pool.h"
+
+/*
+    The counters of each instance are only updated by the threads that use
+    it, and hashwx_verify updates counters that belong to the calling
+    thread. The global counters are the sum of all live instances and
+    threads, which are kept in lists, and of the retired counters of freed
+    instances and exited threads, so hashing never touches a shared cache
+    line.
+*/
+
+typedef struct thread_counters {
+    stats_counters counters;
+    struct thread_counters* prev;
+    struct thread_counters* next;
+} thread_counters;
+
+static stats_counters retired;
+
+static hashwx_ctx* registry = NULL;
+static thread_counters* thread_registry = NULL;
+static hashwx_mutex registry_lock;
+
+#ifdef HASHWX_THREADS
+static once_flag registry_once = ONCE_FLAG_INIT;
+static tss_t thread_key;
+static bool has_thread_key;
+static _Thread_local thread_counters* local_counters;
+
+static void thread_exit(void* counters);
+
+static void registry_init(void) {
+    hashwx_mutex_init(&registry_lock);
+    has_thread_key = tss_create(&thread_key, &thread_exit) == thrd_success;
+}
+#endif
+
+static void lock_registry(void) {
+#ifdef HASHWX_THREADS
+    call_once(&registry_once, &registry_init);
+#endif
+    hashwx_mutex_lock(&registry_lock);
+}
+
+static void counters_init(stats_counters* counters) {
+    atomic_init(&counters->makes, 0);
+    atomic_init(&counters->hashes, 0);
+    atomic_init(&counters->generate_ns, 0);
+    atomic_init(&counters->compile_ns, 0);
+    atomic_init(&counters->exec_ns, 0);
+    for (int i = 0; i < HASHWX_BRANCH_BUCKETS; ++i) {
+        atomic_init(&counters->reg_branches[i], 0);
+        atomic_init(&counters->mem_branches[i], 0);
+    }
+}
+
+static uint64_t load(const atomic_uint_least64_t* counter) {
+    return atomic_load_explicit((atomic_uint_least64_t*)counter, memory_order_relaxed);
+}
+
+/* adds the counters to stats */
+static void counters_read(const stats_counters* counters, hashwx_stats* stats) {
+    stats->makes += load(&counters->makes);
+    stats->hashes += load(&counters->hashes);
+    stats->generate_ns += load(&counters->generate_ns);
+    stats->compile_ns += load(&counters->compile_ns);
+    stats->exec_ns += load(&counters->exec_ns);
+    for (int i = 0; i < HASHWX_BRANCH_BUCKETS; ++i) {
+        stats->reg_branches[i] += load(&counters->reg_branches[i]);
+        stats->mem_branches[i] += load(&counters->mem_branches[i]);
+    }
+}
+
+static void counters_move(stats_counters* counters, stats_counters* total) {
+    stats_add(&total->makes, load(&counters->makes));
+    stats_add(&total->hashes, load(&counters->hashes));
+    stats_add(&total->generate_ns, load(&counters->generate_ns));
+    stats_add(&total->compile_ns, load(&counters->compile_ns));
+    stats_add(&total->exec_ns, load(&counters->exec_ns));
+    for (int i = 0; i < HASHWX_BRANCH_BUCKETS; ++i) {
+        stats_add(&total->reg_branches[i], load(&counters->reg_branches[i]));
+        stats_add(&total->mem_branches[i], load(&counters->mem_branches[i]));
+    }
+}
+
+#ifdef HASHWX_THREADS
+
+/* called when a thread that used hashwx_verify exits */
+static void thread_exit(void* counters) {
+    thread_counters* local = counters;
+    lock_registry();
+    counters_move(&local->counters, &retired);
+    if (local->prev != NULL) {
+        local->prev->next = local->next;
+    }
+    else {
+        thread_registry = local->next;
+    }
+    if (local->next != NULL) {
+        local->next->prev = local->prev;
+    }
+    hashwx_mutex_unlock(&registry_lock);
+    free(local);
+}
+
+#endif
+
+stats_counters* hashwx_stats_local(void) {
+#ifdef HASHWX_THREADS
+    if (local_counters != NULL) {
+        return &local_counters->counters;
+    }
+    thread_counters* local = malloc(sizeof(thread_counters));
+    if (local == NULL) {
+        return &retired;
+    }
+    counters_init(&local->counters);
+    lock_registry();
+    if (!has_thread_key || tss_set(thread_key, local) != thrd_success) {
+        /* the counters couldn't be moved when the thread exits */
+        hashwx_mutex_unlock(&registry_lock);
+        free(local);
+        return &retired;
+    }
+    local->prev = NULL;
+    local->next = thread_registry;
+    if (thread_registry != NULL) {
+        thread_registry->prev = local;
+    }
+    thread_registry = local;
+    hashwx_mutex_unlock(&registry_lock);
+    local_counters = local;
+    return &local->counters;
+#else
+    /* there is only one thread */
+    return &retired;
+#endif
+}
+
+void hashwx_stats_register(hashwx_ctx* ctx) {
+    counters_init(&ctx->stats);
+    lock_registry();
+    ctx->stats_prev = NULL;
+    ctx->stats_next = registry;
+    if (registry != NULL) {
+        registry->stats_prev = ctx;
+    }
+    registry = ctx;
+    hashwx_mutex_unlock(&registry_lock);
+}
+
+void hashwx_stats_unregister(hashwx_ctx* ctx) {
+    lock_registry();
+    counters_move(&ctx->stats, &retired);
+    if (ctx->stats_prev != NULL) {
+        ctx->stats_prev->stats_next = ctx->stats_next;
+    }
+    else {
+        registry = ctx->stats_next;
+    }
+    if (ctx->stats_next != NULL) {
+        ctx->stats_next->stats_prev = ctx->stats_prev;
+    }
+    hashwx_mutex_unlock(&registry_lock);
+}
+
+#endif
+
+int hashwx_get_stats(const hashwx_ctx* ctx, hashwx_stats* stats) {
+    assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+    assert(stats != NULL);
+    memset(stats, 0, sizeof(hashwx_stats));
+#ifdef HASHWX_STATS
+    counters_read(&ctx->stats, stats);
+    return 1;
+#else
+    (void)ctx;
+    return 0;
+#endif
+}
+
+int hashwx_get_global_stats(hashwx_stats* stats) {
+    assert(stats != NULL);
+    memset(stats, 0, sizeof(hashwx_stats));
+#ifdef HASHWX_STATS
+    lock_registry();
+    counters_read(&retired, stats);
+    for (const hashwx_ctx* ctx = registry; ctx != NULL; ctx = ctx->stats_next) {
+        counters_read(&ctx->stats, stats);
+    }
+    for (const thread_counters* local = thread_registry; local != NULL; local = local->next) {
+        counters_read(&local->counters, stats);
+    }
+    hashwx_mutex_unlock(&registry_lock);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static void append(char* buffer, size_t size, size_t* length, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = *length < size ?
+        vsnprintf(&buffer[*length], size - *length, format, args) :
+        vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (written > 0) {
+        *length += (size_t)written;
+    }
+}
+
+static void append_counter(char* buffer, size_t size, size_t* length,
+    const char* name, const char* help, uint64_t value) {
+    append(buffer, size, length, "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 "\n",
+        name, help, name, name, value);
+}
+
+static void append_seconds(char* buffer, size_t size, size_t* length,
+    const char* name, const char* help, uint64_t ns) {
+    append(buffer, size, length, "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 ".%09" PRIu64 "\n",
+        name, help, name, name, ns / 1000000000, ns % 1000000000);
+}
+
+size_t hashwx_format_stats(const hashwx_stats* stats, char* buffer, size_t size) {
+    assert(stats != NULL);
+    assert(buffer != NULL || size == 0);
+    size_t length = 0;
+    if (size > 0) {
+        buffer[0] = '\0';
+    }
+    append_counter(buffer, size, &length, "hashwx_makes_total",
+        "Functions made or imported.", stats->makes);
+    append_counter(buffer, size, &length, "hashwx_hashes_total",
+        "Nonces hashed.", stats->hashes);
+    append_seconds(buffer, size, &length, "hashwx_generate_seconds_total",
+        "Time spent generating interpreted functions.", stats->generate_ns);
+    append_seconds(buffer, size, &length, "hashwx_compile_seconds_total",
+        "Time spent generating and compiling compiled functions.", stats->compile_ns);
+    append_seconds(buffer, size, &length, "hashwx_exec_seconds_total",
+        "Time spent hashing.", stats->exec_ns);
+    append(buffer, size, &length, "# HELP hashwx_branch_iterations_total "
+        "Nonces hashed by the scalar interpreter by branch loop iterations taken in each phase.\n"
+        "# TYPE hashwx_branch_iterations_total counter\n");
+    for (int i = 0; i < HASHWX_BRANCH_BUCKETS; ++i) {
+        append(buffer, size, &length, "hashwx_branch_iterations_total{phase=\"reg\",iterations=\"%i\"} %" PRIu64 "\n",
+            i, stats->reg_branches[i]);
+    }
+    for (int i = 0; i < HASHWX_BRANCH_BUCKETS; ++i) {
+        append(buffer, size, &length, "hashwx_branch_iterations_total{phase=\"mem\",iterations=\"%i\"} %" PRIu64 "\n",
+            i, stats->mem_branches[i]);
+    }
+    return length;
+}
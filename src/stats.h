@@ -0,0 +1,71 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <hashwx.h>
+#include "platform.h"
+
+#ifdef HASHWX_STATS
+
+#include <stdatomic.h>
+
+typedef struct stats_counters {
+    atomic_uint_least64_t makes;
+    atomic_uint_least64_t hashes;
+    atomic_uint_least64_t generate_ns;
+    atomic_uint_least64_t compile_ns;
+    atomic_uint_least64_t exec_ns;
+    atomic_uint_least64_t reg_branches[HASHWX_BRANCH_BUCKETS];
+    atomic_uint_least64_t mem_branches[HASHWX_BRANCH_BUCKETS];
+} stats_counters;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Counters of hashwx_verify calls made by the calling thread */
+HASHWX_PRIVATE stats_counters* hashwx_stats_local(void);
+
+/* Adds an instance to the ones summed by hashwx_get_global_stats */
+HASHWX_PRIVATE void hashwx_stats_register(hashwx_ctx* ctx);
+HASHWX_PRIVATE void hashwx_stats_unregister(hashwx_ctx* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline void stats_add(atomic_uint_least64_t* counter, uint64_t value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+/* counters is the return value of hashwx_program_list_execute */
+static inline void stats_add_branches(stats_counters* stats, uint32_t counters) {
+    stats_add(&stats->reg_branches[32 - (counters & 0xff)], 1);
+    stats_add(&stats->mem_branches[32 - (counters >> 8)], 1);
+}
+
+/*
+    The counters of an instance are updated through const pointers,
+    because instances can be shared by threads that call hashwx_exec.
+*/
+#define STATS_CLOCK(t) uint64_t t = platform_monotonic_ns()
+#define STATS_ADD(stats, field, value) stats_add(&(stats)->field, value)
+#define STATS_TIME(stats, field, t) stats_add(&(stats)->field, platform_monotonic_ns() - (t))
+#define STATS_BRANCHES(stats, counters) stats_add_branches(stats, counters)
+#define CTX_STATS(ctx) (&((hashwx_ctx*)(ctx))->stats)
+#define STATS_LOCAL(stats) stats_counters* stats = hashwx_stats_local()
+
+#else
+
+#define STATS_CLOCK(t)
+#define STATS_LOCAL(stats)
+#define STATS_ADD(stats, field, value)
+#define STATS_TIME(stats, field, t)
+#define STATS_BRANCHES(stats, counters) (void)(counters)
+
+#endif
+
+#endif
@@ -8,6 +8,26 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "cpu.h"
+
+#if defined(HASHWX_CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(HASHWX_CPU_X86)
+#include <x86intrin.h>
+#endif
+
+/*
+    Timer of the benchmarks: reference cycles at the nominal frequency of
+    the CPU on x86-64, monotonic nanoseconds elsewhere.
+*/
+#if defined(HASHWX_CPU_X86)
+#define TIMER_UNIT "tsc"
+#else
+#define TIMER_UNIT "ns"
+#endif
 
 static inline void read_option(const char* option, int argc, char** argv, bool* out) {
     for (int i = 0; i < argc; ++i) {
@@ -28,4 +48,28 @@ static inline void read_int_option(const char* option, int argc, char** argv, in
     *out = default_val;
 }
 
+static inline uint64_t timer_now(void) {
+#if defined(HASHWX_CPU_X86)
+    return __rdtsc();
+#else
+    return platform_monotonic_ns();
+#endif
+}
+
+static inline int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* index of the nearest-rank percentile of count sorted values, p in tenths of a percent */
+static inline size_t percentile_rank(size_t count, unsigned p) {
+    size_t rank = (count * p + 999) / 1000;
+    return rank > 0 ? rank - 1 : 0;
+}
+
+static inline uint64_t percentile(const uint64_t* sorted, size_t count, unsigned p) {
+    return sorted[percentile_rank(count, p)];
+}
+
 #endif
@@ -10,6 +10,13 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <stdlib.h>
+#include <dirent.h>
+#include <unistd.h>
+#define HAVE_DIRENT
+#endif
 
 typedef bool test_func(void);
 
@@ -21,6 +28,16 @@ static hashwx_ctx* ctx_cmp = NULL;
 static const uint8_t seed1[32] = "This is a test seed for hashwx";
 static const uint8_t seed2[32] = "Lorem ipsum dolor sit amet";
 
+#ifndef __EMSCRIPTEN__
+static const uint8_t challenge[32] = "HashWX client puzzle challenge";
+static const uint8_t challenge_seed5[32] = {
+    0x85, 0x58, 0x62, 0x18, 0x99, 0x0c, 0xa5, 0x84,
+    0x38, 0xad, 0x49, 0xf4, 0x89, 0xee, 0xc6, 0x37,
+    0xc9, 0xd1, 0xb3, 0x39, 0xe6, 0x7c, 0xbf, 0xed,
+    0x6e, 0x8e, 0x52, 0xd0, 0xdf, 0x09, 0xe0, 0xe3
+};
+#endif
+
 static const uint64_t counter1 = 0;
 static const uint64_t counter2 = 123456;
 static const uint64_t counter3 = 987654321123456789;
@@ -77,6 +94,196 @@ static bool test_hash4(void) {
     return true;
 }
 
+static bool test_batch(void) {
+    const uint64_t nonces[2] = { counter2, counter3 };
+    uint64_t hashes[2];
+    hashwx_exec_array(ctx_int, nonces, 2, hashes);
+    assert(hashes[0] == hash3);
+    assert(hashes[1] == hash4);
+    /* long enough for the SIMD interpreters and the remainder */
+    uint64_t many[19];
+    hashwx_exec_batch(ctx_int, counter2, 19, many);
+    for (int i = 0; i < 19; ++i) {
+        assert(many[i] == hashwx_exec(ctx_int, counter2 + i));
+    }
+    return true;
+}
+
+static bool search_test(hashwx_ctx* ctx) {
+    uint64_t hashes[16];
+    uint64_t nonce, hash;
+    size_t best = 0;
+    hashwx_exec_batch(ctx, counter2, 16, hashes);
+    for (size_t i = 1; i < 16; ++i) {
+        if (hashes[i] < hashes[best])
+            best = i;
+    }
+    assert(hashwx_search(ctx, counter2, 16, hashes[best] + 1, &nonce, &hash) == 1);
+    assert(nonce == counter2 + best);
+    assert(hash == hashes[best]);
+    assert(hashwx_search(ctx, counter2, 16, hashes[best], &nonce, &hash) == 0);
+    assert(hashwx_search(ctx, counter2, 1, UINT64_MAX, NULL, &hash) == 1);
+    assert(hash == hash3);
+    return true;
+}
+
+static bool test_search(void) {
+    return search_test(ctx_int);
+}
+
+static bool test_verify(void) {
+    assert(hashwx_verify(seed1, counter1) == hash1);
+    assert(hashwx_verify(seed1, counter2) == hash2);
+    assert(hashwx_verify(seed2, counter2) == hash3);
+    assert(hashwx_verify(seed2, counter3) == hash4);
+    return true;
+}
+
+static bool test_verify_many(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    hashwx_verifier* verifier = hashwx_verifier_alloc(HASHWX_INTERPRETED, 3);
+    assert(verifier != NULL);
+    hashwx_proof proofs[9];
+    uint8_t results[2];
+    for (int i = 0; i < 9; ++i) {
+        memcpy(proofs[i].seed, i % 3 ? seed2 : seed1, HASHWX_SEED_SIZE);
+    }
+    /* seed1 */
+    proofs[0].nonce = counter1; proofs[0].target = hash1 + 1;
+    proofs[3].nonce = counter2; proofs[3].target = hash2;
+    proofs[6].nonce = counter2; proofs[6].target = hash2 + 1;
+    /* seed2 */
+    proofs[1].nonce = counter2; proofs[1].target = hash3 + 1;
+    proofs[2].nonce = counter3; proofs[2].target = hash4 + 1;
+    proofs[4].nonce = counter3; proofs[4].target = hash4;
+    proofs[5].nonce = counter2; proofs[5].target = 0;
+    proofs[7].nonce = counter3; proofs[7].target = UINT64_MAX;
+    proofs[8].nonce = counter2; proofs[8].target = hash3;
+    assert(hashwx_verify_many(verifier, proofs, 9, results) == 5);
+    assert(results[0] == 0xc7 && results[1] == 0x00);
+    assert(hashwx_verify_many(verifier, proofs + 1, 1, results) == 1);
+    assert(results[0] == 0x01);
+    hashwx_verifier_free(verifier);
+    return true;
+#endif
+}
+
+static bool test_puzzle_seed(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    uint8_t seed[HASHWX_SEED_SIZE];
+    hashwx_puzzle_seed(challenge, 5, seed);
+    assert(memcmp(seed, challenge_seed5, HASHWX_SEED_SIZE) == 0);
+    return true;
+#endif
+}
+
+static bool cache_test(hashwx_type type) {
+#ifdef __EMSCRIPTEN__
+    (void)type;
+    return false;
+#else
+    hashwx_cache_stats stats;
+    hashwx_cache* cache = hashwx_cache_alloc(type, 1 << 20);
+    if (cache == NULL)
+        return false;
+    assert(hashwx_cache_exec(cache, seed1, counter1) == hash1);
+    assert(hashwx_cache_exec(cache, seed2, counter2) == hash3);
+    assert(hashwx_cache_exec(cache, seed1, counter2) == hash2);
+    assert(hashwx_cache_exec(cache, seed2, counter3) == hash4);
+    hashwx_cache_get_stats(cache, &stats);
+    assert(stats.hits == 2 && stats.misses == 2 && stats.evictions == 0);
+    assert(stats.entries == 2 && stats.capacity >= 2);
+    hashwx_cache_free(cache);
+    /* a cache with a single entry must evict the previous seed */
+    cache = hashwx_cache_alloc(type, 0);
+    assert(cache != NULL);
+    assert(hashwx_cache_exec(cache, seed1, counter1) == hash1);
+    assert(hashwx_cache_exec(cache, seed2, counter2) == hash3);
+    assert(hashwx_cache_exec(cache, seed1, counter2) == hash2);
+    hashwx_cache_get_stats(cache, &stats);
+    assert(stats.hits == 0 && stats.misses == 3 && stats.evictions == 2);
+    assert(stats.entries == 1 && stats.capacity == 1);
+    hashwx_cache_free(cache);
+    return true;
+#endif
+}
+
+static bool puzzle_test(hashwx_type type) {
+#ifdef __EMSCRIPTEN__
+    (void)type;
+    return false;
+#else
+    const uint64_t target = UINT64_MAX / 2000;
+    uint64_t nonce, hash;
+    uint8_t seed[HASHWX_SEED_SIZE];
+    hashwx_puzzle* puzzle = hashwx_puzzle_alloc(type);
+    if (puzzle == NULL)
+        return false;
+    /* solve in two parts to cross a window boundary */
+    int found = hashwx_puzzle_solve(puzzle, challenge, target, HASHWX_PUZZLE_ATTEMPTS,
+        1000, 300, &nonce, &hash);
+    if (!found) {
+        found = hashwx_puzzle_solve(puzzle, challenge, target, HASHWX_PUZZLE_ATTEMPTS,
+            1300, 100000, &nonce, &hash);
+    }
+    assert(found);
+    assert(nonce >= 1000 && hash < target);
+    hashwx_puzzle_seed(challenge, nonce / HASHWX_PUZZLE_ATTEMPTS, seed);
+    assert(hashwx_verify(seed, nonce) == hash);
+    assert(hashwx_puzzle_verify(challenge, HASHWX_PUZZLE_ATTEMPTS, nonce, target));
+    assert(hashwx_puzzle_verify(challenge, HASHWX_PUZZLE_ATTEMPTS, nonce, hash + 1));
+    assert(!hashwx_puzzle_verify(challenge, HASHWX_PUZZLE_ATTEMPTS, nonce, hash));
+    /* the solution must be the first one */
+    assert(!hashwx_puzzle_solve(puzzle, challenge, target, HASHWX_PUZZLE_ATTEMPTS,
+        1000, nonce - 1000, NULL, NULL));
+    hashwx_puzzle_free(puzzle);
+    return true;
+#endif
+}
+
+static bool test_cache(void) {
+    return cache_test(HASHWX_INTERPRETED);
+}
+
+static bool test_puzzle(void) {
+    return puzzle_test(HASHWX_INTERPRETED);
+}
+
+#ifndef __EMSCRIPTEN__
+static int progress_cancel(void* user_data, uint64_t hashes) {
+    (void)hashes;
+    return --*(int*)user_data <= 0;
+}
+#endif
+
+static bool test_solver(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    const uint64_t target = UINT64_MAX / 2000;
+    uint64_t nonce, hash;
+    int countdown = 3;
+    hashwx_solver* solver = hashwx_solver_alloc(HASHWX_INTERPRETED, 4);
+    assert(solver != NULL);
+    assert(hashwx_solver_run(solver, challenge, target, HASHWX_PUZZLE_ATTEMPTS,
+        1000, 100000, NULL, NULL, &nonce, &hash) == 1);
+    assert(nonce >= 1000 && nonce < 101000 && hash < target);
+    assert(hashwx_puzzle_verify(challenge, HASHWX_PUZZLE_ATTEMPTS, nonce, target));
+    /* no solution in a short range */
+    assert(hashwx_solver_run(solver, challenge, 0, HASHWX_PUZZLE_ATTEMPTS,
+        1000, 1000, NULL, NULL, &nonce, &hash) == 0);
+    /* cancellation from the progress callback */
+    assert(hashwx_solver_run(solver, challenge, 0, HASHWX_PUZZLE_ATTEMPTS,
+        0, UINT64_MAX, &progress_cancel, &countdown, NULL, NULL) == -1);
+    hashwx_solver_free(solver);
+    return true;
+#endif
+}
+
 static bool test_compiler_alloc(void) {
     ctx_cmp = hashwx_alloc(HASHWX_COMPILED);
     assert(ctx_cmp != NULL);
@@ -135,6 +342,400 @@ static bool test_compiler_hash4(void) {
     return true;
 }
 
+static bool test_compiler_batch(void) {
+    if (ctx_cmp == HASHWX_NOTSUPP)
+        return false;
+
+    const uint64_t nonces[2] = { counter2, counter3 };
+    uint64_t hashes[2];
+    hashwx_exec_array(ctx_cmp, nonces, 2, hashes);
+    assert(hashes[0] == hash3);
+    assert(hashes[1] == hash4);
+    uint64_t many[19];
+    hashwx_exec_batch(ctx_cmp, counter2, 19, many);
+    for (int i = 0; i < 19; ++i) {
+        assert(many[i] == hashwx_verify(seed2, counter2 + i));
+    }
+    return true;
+}
+
+static bool test_compiler_search(void) {
+    if (ctx_cmp == HASHWX_NOTSUPP)
+        return false;
+
+    return search_test(ctx_cmp);
+}
+
+static bool test_compiler_cache(void) {
+    if (ctx_cmp == HASHWX_NOTSUPP)
+        return false;
+
+    return cache_test(HASHWX_COMPILED);
+}
+
+static bool test_compiler_puzzle(void) {
+    if (ctx_cmp == HASHWX_NOTSUPP)
+        return false;
+
+    return puzzle_test(HASHWX_COMPILED);
+}
+
+static bool test_compiler_dual(void) {
+    hashwx_ctx* ctx = hashwx_alloc(HASHWX_COMPILED | HASHWX_DUAL_MAPPED);
+    if (ctx == HASHWX_NOTSUPP)
+        return false;
+
+    assert(ctx != NULL);
+    hashwx_make(ctx, seed1);
+    assert(hashwx_exec(ctx, counter1) == hash1);
+    assert(hashwx_exec(ctx, counter2) == hash2);
+    hashwx_make(ctx, seed2);
+    assert(hashwx_exec(ctx, counter2) == hash3);
+    assert(hashwx_exec(ctx, counter3) == hash4);
+    hashwx_free(ctx);
+    return true;
+}
+
+static bool test_auto(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    const hashwx_type types[2] = { HASHWX_AUTO, HASHWX_AUTO | HASHWX_DUAL_MAPPED };
+    for (int i = 0; i < 2; ++i) {
+        hashwx_ctx* ctx = hashwx_alloc(types[i]);
+        assert(ctx != NULL && ctx != HASHWX_NOTSUPP);
+        hashwx_set_jit_threshold(ctx, 2);
+        hashwx_make(ctx, seed1);
+        /* the first 2 nonces are interpreted */
+        assert(hashwx_exec(ctx, counter1) == hash1);
+        assert(hashwx_exec(ctx, counter2) == hash2);
+        assert(hashwx_exec(ctx, counter1) == hash1);
+        hashwx_make(ctx, seed2);
+        assert(hashwx_exec(ctx, counter2) == hash3);
+        uint64_t many[19];
+        hashwx_exec_batch(ctx, counter2, 19, many);
+        for (int j = 0; j < 19; ++j) {
+            assert(many[j] == hashwx_verify(seed2, counter2 + j));
+        }
+        /* the threshold is crossed in the middle of search_test */
+        hashwx_set_jit_threshold(ctx, 20);
+        hashwx_make(ctx, seed2);
+        search_test(ctx);
+        hashwx_free(ctx);
+    }
+    assert(hashwx_cache_alloc(HASHWX_AUTO, 0) == NULL);
+    return true;
+#endif
+}
+
+static bool test_export(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    uint8_t data[HASHWX_EXPORT_SIZE];
+    hashwx_export_program(seed1, data);
+    hashwx_ctx* ctx = hashwx_alloc(HASHWX_INTERPRETED);
+    assert(ctx != NULL);
+    assert(hashwx_import_program(ctx, data) == 1);
+    assert(hashwx_exec(ctx, counter1) == hash1);
+    assert(hashwx_exec(ctx, counter2) == hash2);
+    if (ctx_cmp != HASHWX_NOTSUPP) {
+        assert(hashwx_import_program(ctx_cmp, data) == 1);
+        assert(hashwx_exec(ctx_cmp, counter1) == hash1);
+    }
+    /* unknown version */
+    data[3]++;
+    assert(hashwx_import_program(ctx, data) == 0);
+    data[3]--;
+    /* the first instruction of each program must be INSTR_RMCG */
+    data[20 + 32 * 5] ^= 1;
+    assert(hashwx_import_program(ctx, data) == 0);
+    data[20 + 32 * 5] ^= 1;
+    /* src == dst */
+    uint8_t src = data[20 + 5];
+    data[20 + 5] = data[20 + 6];
+    assert(hashwx_import_program(ctx, data) == 0);
+    data[20 + 5] = src;
+    /* sources outside the permitted permutations: src1 == dst0, src2 == dst0, src8 == dst6 */
+    static const int bad_sources[3][2] = { { 1, 0 }, { 2, 0 }, { 7, 6 } };
+    for (int i = 0; i < 3; ++i) {
+        src = data[20 + 4 * bad_sources[i][0] + 1];
+        data[20 + 4 * bad_sources[i][0] + 1] = data[20 + 4 * bad_sources[i][1] + 2];
+        assert(hashwx_import_program(ctx, data) == 0);
+        data[20 + 4 * bad_sources[i][0] + 1] = src;
+    }
+    assert(hashwx_import_program(ctx, data) == 1);
+    /* duplicate destination register */
+    data[20 + 6] = data[20 + 4 + 6];
+    assert(hashwx_import_program(ctx, data) == 0);
+    hashwx_free(ctx);
+    return true;
+#endif
+}
+
+static bool test_pack(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    const char* path = "hashwx-tests.pack";
+    const uint8_t seeds[3][HASHWX_SEED_SIZE] = {
+        "Lorem ipsum dolor sit amet",
+        "This is a test seed for hashwx",
+        "Lorem ipsum dolor sit amet",
+    };
+    assert(hashwx_pack_write(path, seeds, 3) == 1);
+    hashwx_pack* pack = hashwx_pack_open(path);
+    assert(pack != NULL);
+    hashwx_ctx* ctx = hashwx_alloc(HASHWX_INTERPRETED);
+    assert(ctx != NULL);
+    const uint8_t* data = hashwx_pack_find(pack, seed2);
+    assert(data != NULL);
+    assert(hashwx_import_program(ctx, data) == 1);
+    assert(hashwx_exec(ctx, counter2) == hash3);
+    data = hashwx_pack_find(pack, seed1);
+    assert(data != NULL);
+    assert(hashwx_import_program(ctx, data) == 1);
+    assert(hashwx_exec(ctx, counter1) == hash1);
+    assert(hashwx_pack_find(pack, challenge) == NULL);
+#ifndef HASHWX_WIN
+    /* an open pack is not affected when the file is rewritten */
+    assert(hashwx_pack_write(path, NULL, 0) == 1);
+    data = hashwx_pack_find(pack, seed2);
+    assert(data != NULL);
+    assert(hashwx_import_program(ctx, data) == 1);
+    assert(hashwx_exec(ctx, counter2) == hash3);
+#endif
+    hashwx_pack_close(pack);
+    hashwx_free(ctx);
+    /* empty pack */
+    assert(hashwx_pack_write(path, NULL, 0) == 1);
+    pack = hashwx_pack_open(path);
+    assert(pack != NULL);
+    assert(hashwx_pack_find(pack, seed1) == NULL);
+    hashwx_pack_close(pack);
+    remove(path);
+    assert(hashwx_pack_open(path) == NULL);
+    return true;
+#endif
+}
+
+#ifdef HAVE_DIRENT
+/* Returns the number of files in dir, the path of the last one goes to path */
+static int list_dir(const char* dir, char* path, size_t size) {
+    DIR* d = opendir(dir);
+    assert(d != NULL);
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            snprintf(path, size, "%s/%s", dir, entry->d_name);
+            count++;
+        }
+    }
+    closedir(d);
+    return count;
+}
+#endif
+
+static bool test_code_cache(void) {
+#ifndef HAVE_DIRENT
+    return false;
+#else
+    hashwx_ctx* ctx = hashwx_alloc(HASHWX_COMPILED);
+    if (ctx == HASHWX_NOTSUPP) {
+        return false;
+    }
+    assert(ctx != NULL);
+    char dir[] = "hashwx-tests.XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    if (!hashwx_set_code_cache(ctx, dir)) {
+        hashwx_free(ctx);
+        rmdir(dir);
+        return false;
+    }
+    char path[512];
+    /* compiled and added to the cache */
+    hashwx_make(ctx, seed1);
+    assert(hashwx_exec(ctx, counter1) == hash1);
+    assert(list_dir(dir, path, sizeof(path)) == 1);
+    /* mapped from the cache */
+    hashwx_ctx* ctx2 = hashwx_alloc(HASHWX_COMPILED);
+    assert(ctx2 != NULL);
+    assert(hashwx_set_code_cache(ctx2, dir) == 1);
+    hashwx_make(ctx2, seed1);
+    assert(hashwx_exec(ctx2, counter1) == hash1);
+    assert(hashwx_exec(ctx2, counter2) == hash2);
+    hashwx_make(ctx2, seed2);
+    assert(hashwx_exec(ctx2, counter2) == hash3);
+    assert(list_dir(dir, path, sizeof(path)) == 2);
+    hashwx_make(ctx2, seed1);
+    assert(hashwx_exec(ctx2, counter1) == hash1);
+    /* the file can be deleted while it's mapped */
+    assert(list_dir(dir, path, sizeof(path)) == 2);
+    assert(remove(path) == 0);
+    assert(hashwx_exec(ctx2, counter1) == hash1);
+    /* invalid files are replaced */
+    hashwx_make(ctx, seed1);
+    hashwx_make(ctx, seed2);
+    list_dir(dir, path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    assert(file != NULL);
+    fputs("invalid", file);
+    fclose(file);
+    hashwx_make(ctx2, seed1);
+    assert(hashwx_exec(ctx2, counter1) == hash1);
+    hashwx_make(ctx2, seed2);
+    assert(hashwx_exec(ctx2, counter2) == hash3);
+    hashwx_make(ctx, seed2);
+    assert(hashwx_exec(ctx, counter2) == hash3);
+    /* the cache is not used after it's disabled */
+    hashwx_make(ctx2, seed2);
+    assert(hashwx_exec(ctx2, counter2) == hash3);
+    assert(hashwx_set_code_cache(ctx2, NULL) == 1);
+    hashwx_make(ctx2, seed1);
+    assert(hashwx_exec(ctx2, counter1) == hash1);
+    assert(hashwx_exec(ctx2, counter2) == hashwx_verify(seed1, counter2));
+    hashwx_free(ctx);
+    hashwx_free(ctx2);
+    while (list_dir(dir, path, sizeof(path)) > 0) {
+        assert(remove(path) == 0);
+    }
+    assert(rmdir(dir) == 0);
+    ctx = hashwx_alloc(HASHWX_INTERPRETED);
+    assert(ctx != NULL);
+    assert(hashwx_set_code_cache(ctx, ".") == 0);
+    hashwx_free(ctx);
+    return true;
+#endif
+}
+
+static bool test_perf_map(void) {
+#if !defined(__linux__)
+    return false;
+#else
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/perf-%ld.map", (long)getpid());
+    remove(path);
+    assert(setenv("HASHWX_PERF_MAP", "1", 1) == 0);
+    hashwx_ctx* ctx = hashwx_alloc(HASHWX_COMPILED);
+    assert(unsetenv("HASHWX_PERF_MAP") == 0);
+    if (ctx == HASHWX_NOTSUPP) {
+        return false;
+    }
+    assert(ctx != NULL);
+    hashwx_make(ctx, seed1);
+    assert(hashwx_exec(ctx, counter1) == hash1);
+    FILE* file = fopen(path, "r");
+    assert(file != NULL);
+    char line[128];
+    int lines = 0;
+    bool found = false, body = false, loop = false;
+    unsigned long next = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        unsigned long address;
+        unsigned size;
+        char name[64];
+        assert(sscanf(line, "%lx %x %63s", &address, &size, name) == 3);
+        /* the entries cover the code without gaps or overlaps */
+        assert(lines == 0 || address == next);
+        next = address + size;
+        found = found || strcmp(name, "hashwx_mem_program_31") == 0;
+        body = body || strcmp(name, "hashwx_body_begin") == 0;
+        loop = loop || strcmp(name, "hashwx_loop") == 0;
+        lines++;
+    }
+    fclose(file);
+    /* prologue, 32 + 32 programs, start of the memory phase, epilogue,
+       start and end of the body if it's separate, nonce loop */
+    int entries = 67 + (body ? 2 : 0) + (loop ? 1 : 0);
+    assert(lines == entries);
+    assert(found);
+    remove(path);
+#ifdef HAVE_DIRENT
+    /* cache files mapped at an address that has entries are not added again */
+    char dir[] = "hashwx-tests.XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    assert(hashwx_set_code_cache(ctx, dir) == 1);
+    hashwx_make(ctx, seed1);
+    assert(setenv("HASHWX_PERF_MAP", "1", 1) == 0);
+    for (int i = 0; i < 10; ++i) {
+        hashwx_make(ctx, seed1);
+        assert(hashwx_exec(ctx, counter1) == hash1);
+    }
+    assert(unsetenv("HASHWX_PERF_MAP") == 0);
+    file = fopen(path, "r");
+    assert(file != NULL);
+    lines = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lines++;
+    }
+    fclose(file);
+    assert(lines % entries == 0 && lines < 10 * entries);
+    remove(path);
+    assert(hashwx_set_code_cache(ctx, NULL) == 1);
+    char cached[512];
+    while (list_dir(dir, cached, sizeof(cached)) > 0) {
+        assert(remove(cached) == 0);
+    }
+    assert(rmdir(dir) == 0);
+#endif
+    hashwx_free(ctx);
+    /* disabled by default */
+    ctx = hashwx_alloc(HASHWX_COMPILED);
+    assert(ctx != NULL);
+    assert(fopen(path, "r") == NULL);
+    hashwx_free(ctx);
+    return true;
+#endif
+}
+
+static bool test_stats(void) {
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    hashwx_stats before, after, stats;
+    if (!hashwx_get_global_stats(&before)) {
+        hashwx_ctx* ctx = hashwx_alloc(HASHWX_INTERPRETED);
+        assert(ctx != NULL);
+        assert(hashwx_get_stats(ctx, &stats) == 0);
+        assert(stats.makes == 0 && stats.hashes == 0);
+        hashwx_free(ctx);
+        return false;
+    }
+    hashwx_ctx* ctx = hashwx_alloc(HASHWX_INTERPRETED);
+    assert(ctx != NULL);
+    hashwx_make(ctx, seed1);
+    assert(hashwx_exec(ctx, counter1) == hash1);
+    uint64_t out[3];
+    hashwx_exec_batch(ctx, counter1, 3, out);
+    assert(out[0] == hash1);
+    assert(hashwx_get_stats(ctx, &stats) == 1);
+    assert(stats.makes == 1);
+    assert(stats.hashes == 4);
+    uint64_t reg_hashes = 0, mem_hashes = 0;
+    for (int i = 0; i < HASHWX_BRANCH_BUCKETS; ++i) {
+        reg_hashes += stats.reg_branches[i];
+        mem_hashes += stats.mem_branches[i];
+    }
+    assert(reg_hashes == 4 && mem_hashes == 4);
+    char text[8192];
+    size_t length = hashwx_format_stats(&stats, NULL, 0);
+    assert(hashwx_format_stats(&stats, text, sizeof(text)) == length);
+    assert(length < sizeof(text) && strlen(text) == length);
+    assert(strstr(text, "\nhashwx_makes_total 1\n") != NULL);
+    assert(strstr(text, "\nhashwx_hashes_total 4\n") != NULL);
+    assert(hashwx_format_stats(&stats, text, 16) == length);
+    assert(strlen(text) == 15);
+    /* freed instances and hashwx_verify are included in the global counters */
+    hashwx_free(ctx);
+    assert(hashwx_verify(seed1, counter1) == hash1);
+    assert(hashwx_get_global_stats(&after) == 1);
+    assert(after.makes - before.makes == 1);
+    assert(after.hashes - before.hashes == 5);
+    return true;
+#endif
+}
+
 static bool test_free(void) {
     hashwx_free(ctx_int);
     hashwx_free(ctx_cmp);
@@ -149,6 +750,14 @@ int main(void) {
     RUN_TEST(test_make2);
     RUN_TEST(test_hash3);
     RUN_TEST(test_hash4);
+    RUN_TEST(test_batch);
+    RUN_TEST(test_search);
+    RUN_TEST(test_verify);
+    RUN_TEST(test_verify_many);
+    RUN_TEST(test_cache);
+    RUN_TEST(test_puzzle_seed);
+    RUN_TEST(test_puzzle);
+    RUN_TEST(test_solver);
     RUN_TEST(test_compiler_alloc);
     RUN_TEST(test_compiler_make1);
     RUN_TEST(test_compiler_hash1);
@@ -156,6 +765,17 @@ int main(void) {
     RUN_TEST(test_compiler_make2);
     RUN_TEST(test_compiler_hash3);
     RUN_TEST(test_compiler_hash4);
+    RUN_TEST(test_compiler_batch);
+    RUN_TEST(test_compiler_search);
+    RUN_TEST(test_compiler_cache);
+    RUN_TEST(test_compiler_puzzle);
+    RUN_TEST(test_compiler_dual);
+    RUN_TEST(test_auto);
+    RUN_TEST(test_export);
+    RUN_TEST(test_pack);
+    RUN_TEST(test_code_cache);
+    RUN_TEST(test_perf_map);
+    RUN_TEST(test_stats);
     RUN_TEST(test_free);
 
     printf("\nAll tests were successful\n");
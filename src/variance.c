@@ -0,0 +1,594 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+/*
+    Measures how much the cost of a hash depends on the seed. For every
+    seed, the same nonces are hashed by the interpreter and by the compiled
+    function, and the mean and the 99th percentile of the cost of one hash
+    are recorded. Seeds whose mean or tail cost is far above the median seed
+    are reported as outliers.
+
+    The data-dependent part of the cost is the branch loop of each program:
+    a taken INSTR_BRANCH executes instructions 0-7 of the program again,
+    until the 32 iterations of the phase are used up. The number of executed
+    instructions is exact and the same in both modes:
+
+        2 phases * 32 programs * 9 instructions + 8 * taken iterations
+
+    Costs are measured like in hashwx-microbench (reference cycles on
+    x86-64, nanoseconds elsewhere) and include register initialization and
+    finalization. The first nonce of each seed is hashed once without being
+    measured, so the branch predictors are trained the same way for all
+    measured nonces. Seeds that look like outliers are measured twice more
+    and keep the lowest mean and p99 of the three runs, so that seeds which
+    were hit by an interrupt or a context switch are not reported.
+*/
+
+#include "test_utils.h"
+#include "platform.h"
+#include "siphash_rng.h"
+#include "program.h"
+#include "compiler.h"
+#include "context.h"
+
+#include <hashwx.h>
+#include <math.h>
+#include <inttypes.h>
+#if defined(HASHWX_THREADS)
+#include <threads.h>
+#else
+typedef int thrd_t;
+#endif
+
+typedef enum mode_id {
+    MODE_INTERPRETED,
+    MODE_COMPILED,
+    MODE_COUNT
+} mode_id;
+
+static const char* mode_names[MODE_COUNT] = {
+    [MODE_INTERPRETED] = "interpreted",
+    [MODE_COMPILED] = "compiled",
+};
+
+/* instructions executed when no branch is taken */
+#define BASE_INSTRUCTIONS (2 * HASHWX_NUM_PROGRAMS * 9)
+/* taken branch iterations of both phases */
+#define MAX_ITERATIONS 64
+#define ITERATION_INSTRUCTIONS 8
+
+/* costs per hash are counted in 4 logarithmic buckets per power of 2 */
+#define LOG_SUB_BUCKETS 4
+#define LOG_BUCKETS (64 * LOG_SUB_BUCKETS)
+
+#define MAX_OUTLIERS_SHOWN 20
+
+typedef struct seed_record {
+    uint64_t index;
+    double mean[MODE_COUNT];
+    uint64_t p99[MODE_COUNT];
+    double instructions;
+} seed_record;
+
+typedef struct variance_job {
+    int id;
+    int threads;
+    thrd_t thread;
+    uint64_t seeds;
+    int nonces;
+    hashwx_ctx* ctx;
+    hashwx_program_list* program_list;
+    uint64_t* samples[MODE_COUNT];
+    seed_record* records;
+    uint64_t hash_buckets[MODE_COUNT][LOG_BUCKETS];
+    uint64_t iterations[MAX_ITERATIONS + 1];
+    bool mismatch;
+} variance_job;
+
+static const siphash_key variance_key = {
+    .k0 = 0x76617269616e6365,
+    .k1 = 0x2068617368777820
+};
+
+/* the seed and the keys of the seed with the given index */
+static void make_seed(uint64_t index, uint8_t seed[HASHWX_SEED_SIZE], siphash_key keys[2]) {
+    siphash_rng gen;
+    hashwx_rng_init(&gen, &variance_key, index);
+    for (int j = 0; j < 4; ++j) {
+        platform_store64(&seed[8 * j], gen.state[j]);
+    }
+    keys[0].k0 = gen.state[0];
+    keys[0].k1 = gen.state[1];
+    keys[1].k0 = gen.state[2];
+    keys[1].k1 = gen.state[3];
+}
+
+static int log_bucket(uint64_t value) {
+    if (value < LOG_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int log = 2;
+    while ((value >> (log + 1)) != 0) {
+        log++;
+    }
+    return log * LOG_SUB_BUCKETS + (int)((value >> (log - 2)) & (LOG_SUB_BUCKETS - 1));
+}
+
+static uint64_t log_bucket_min(int bucket) {
+    if (bucket < LOG_SUB_BUCKETS) {
+        return (uint64_t)bucket;
+    }
+    int log = bucket / LOG_SUB_BUCKETS;
+    return (uint64_t)(LOG_SUB_BUCKETS + bucket % LOG_SUB_BUCKETS) << (log - 2);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Measures seed s. The histograms are only updated if histograms is true. */
+static void measure_seed(variance_job* job, uint64_t s, seed_record* record, bool histograms) {
+    uint64_t r[HASHWX_REG_SIZE];
+    uint8_t seed[HASHWX_SEED_SIZE];
+    siphash_key keys[2];
+    make_seed(s, seed, keys);
+    hashwx_program_list_generate(&keys[0], job->program_list);
+    if (job->ctx != NULL) {
+        hashwx_make(job->ctx, seed);
+    }
+    uint64_t iterations = 0;
+    for (int n = -1; n < job->nonces; ++n) {
+        uint64_t nonce = (uint64_t)(n + 1);
+        uint64_t start = timer_now();
+        init_registers(&keys[1], nonce, r);
+        uint32_t counters = hashwx_program_list_execute(job->program_list, r);
+        uint64_t hash = finalize_registers(r);
+        uint64_t cost_int = timer_now() - start;
+        uint64_t cost_cmp = 0;
+#if HASHWX_COMPILER && !defined(HASHWX_COMPILER_WASM)
+        if (job->ctx != NULL) {
+            start = timer_now();
+            init_registers(&keys[1], nonce, r);
+            job->ctx->func(r);
+            uint64_t hash_cmp = finalize_registers(r);
+            cost_cmp = timer_now() - start;
+            job->mismatch |= hash_cmp != hash;
+        }
+#endif
+        if (n < 0) {
+            continue;
+        }
+        int taken = 2 * 32 - (int)(counters & 0xff) - (int)(counters >> 8);
+        iterations += (uint64_t)taken;
+        job->samples[MODE_INTERPRETED][n] = cost_int;
+        job->samples[MODE_COMPILED][n] = cost_cmp;
+        if (histograms) {
+            job->iterations[taken]++;
+            job->hash_buckets[MODE_INTERPRETED][log_bucket(cost_int)]++;
+            job->hash_buckets[MODE_COMPILED][log_bucket(cost_cmp)]++;
+        }
+    }
+    record->index = s;
+    record->instructions = BASE_INSTRUCTIONS + ITERATION_INSTRUCTIONS * (double)iterations / job->nonces;
+    for (int m = 0; m < MODE_COUNT; ++m) {
+        uint64_t* samples = job->samples[m];
+        double sum = 0;
+        for (int n = 0; n < job->nonces; ++n) {
+            sum += (double)samples[n];
+        }
+        qsort(samples, job->nonces, sizeof(uint64_t), &compare_u64);
+        record->mean[m] = sum / job->nonces;
+        record->p99[m] = percentile(samples, job->nonces, 990);
+    }
+}
+
+static int worker(void* args) {
+    variance_job* job = (variance_job*)args;
+    job->mismatch = false;
+    for (uint64_t s = (uint64_t)job->id; s < job->seeds; s += (uint64_t)job->threads) {
+        measure_seed(job, s, &job->records[s], true);
+    }
+    return 0;
+}
+
+typedef struct mode_summary {
+    double mean, cv, min, p50, p99, max;
+    double tail_p50, tail_max;
+    double correlation;
+} mode_summary;
+
+/* Pearson correlation of the mean cost and the mean instruction count of the seeds */
+static double correlation(const seed_record* records, uint64_t seeds, int m) {
+    double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    for (uint64_t s = 0; s < seeds; ++s) {
+        double x = records[s].instructions, y = records[s].mean[m];
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        syy += y * y;
+        sxy += x * y;
+    }
+    double cov = sxy - sx * sy / seeds;
+    double vx = sxx - sx * sx / seeds;
+    double vy = syy - sy * sy / seeds;
+    return vx > 0 && vy > 0 ? cov / sqrt(vx * vy) : 0;
+}
+
+static void summarize(const seed_record* records, uint64_t seeds, int m, double* values, mode_summary* summary) {
+    double sum = 0, sum_sq = 0;
+    for (uint64_t s = 0; s < seeds; ++s) {
+        values[s] = records[s].mean[m];
+        sum += values[s];
+        sum_sq += values[s] * values[s];
+    }
+    qsort(values, seeds, sizeof(double), &compare_double);
+    summary->mean = sum / seeds;
+    double variance = sum_sq / seeds - summary->mean * summary->mean;
+    summary->cv = summary->mean > 0 && variance > 0 ? sqrt(variance) / summary->mean : 0;
+    summary->min = values[0];
+    summary->p50 = values[percentile_rank(seeds, 500)];
+    summary->p99 = values[percentile_rank(seeds, 990)];
+    summary->max = values[seeds - 1];
+    for (uint64_t s = 0; s < seeds; ++s) {
+        values[s] = (double)records[s].p99[m];
+    }
+    qsort(values, seeds, sizeof(double), &compare_double);
+    summary->tail_p50 = values[percentile_rank(seeds, 500)];
+    summary->tail_max = values[seeds - 1];
+    summary->correlation = correlation(records, seeds, m);
+}
+
+/* the lower bound of the log bucket that contains the given percentile */
+static uint64_t bucket_percentile(const uint64_t buckets[LOG_BUCKETS], uint64_t total, unsigned p) {
+    uint64_t rank = percentile_rank(total, p) + 1, seen = 0;
+    for (int b = 0; b < LOG_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return log_bucket_min(b);
+        }
+    }
+    return 0;
+}
+
+static void print_bar(uint64_t count, uint64_t max_count) {
+    int width = max_count > 0 ? (int)((count * 50 + max_count - 1) / max_count) : 0;
+    for (int i = 0; i < width; ++i) {
+        putchar('#');
+    }
+    putchar('\n');
+}
+
+/* linear histogram of the per-seed means */
+static void seed_histogram(const seed_record* records, uint64_t seeds, int m, const mode_summary* summary,
+    int bins, uint64_t* counts) {
+    memset(counts, 0, sizeof(uint64_t) * bins);
+    double width = (summary->max - summary->min) / bins;
+    for (uint64_t s = 0; s < seeds; ++s) {
+        int bin = width > 0 ? (int)((records[s].mean[m] - summary->min) / width) : 0;
+        counts[bin < bins ? bin : bins - 1]++;
+    }
+}
+
+static void print_text(const seed_record* records, uint64_t seeds, int nonces, int modes,
+    const mode_summary* summary, uint64_t (*hash_buckets)[LOG_BUCKETS], const uint64_t* iterations,
+    int bins, uint64_t* counts, uint64_t outliers, const seed_record** worst, int outlier_percent) {
+    uint64_t hashes = seeds * (uint64_t)nonces;
+    printf("\nPer-seed mean cost of a hash (%s):\n", TIMER_UNIT);
+    printf("%-12s %10s %7s %10s %10s %10s %10s %8s\n", "mode", "mean", "cv %", "min", "p50", "p99", "max", "max/p50");
+    for (int m = 0; m < modes; ++m) {
+        const mode_summary* ms = &summary[m];
+        printf("%-12s %10.1f %7.2f %10.1f %10.1f %10.1f %10.1f %8.3f\n", mode_names[m], ms->mean, ms->cv * 100,
+            ms->min, ms->p50, ms->p99, ms->max, ms->max / ms->p50);
+    }
+    printf("\nPer-seed p99 cost of a hash (%s):\n", TIMER_UNIT);
+    printf("%-12s %10s %10s %8s\n", "mode", "p50", "max", "max/p50");
+    for (int m = 0; m < modes; ++m) {
+        const mode_summary* ms = &summary[m];
+        printf("%-12s %10.0f %10.0f %8.3f\n", mode_names[m], ms->tail_p50, ms->tail_max, ms->tail_max / ms->tail_p50);
+    }
+    printf("\nCost of all hashes (%s, bucket lower bounds):\n", TIMER_UNIT);
+    printf("%-12s %10s %10s %10s %10s\n", "mode", "p50", "p99", "p99.9", "max");
+    for (int m = 0; m < modes; ++m) {
+        printf("%-12s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n", mode_names[m],
+            bucket_percentile(hash_buckets[m], hashes, 500), bucket_percentile(hash_buckets[m], hashes, 990),
+            bucket_percentile(hash_buckets[m], hashes, 999), bucket_percentile(hash_buckets[m], hashes, 1000));
+    }
+    uint64_t total_iterations = 0;
+    int min_taken = MAX_ITERATIONS, max_taken = 0;
+    for (int k = 0; k <= MAX_ITERATIONS; ++k) {
+        total_iterations += iterations[k] * (uint64_t)k;
+        if (iterations[k] > 0) {
+            min_taken = k < min_taken ? k : min_taken;
+            max_taken = k;
+        }
+    }
+    printf("\nExecuted instructions per hash: mean %.1f, min %i, max %i\n",
+        BASE_INSTRUCTIONS + ITERATION_INSTRUCTIONS * (double)total_iterations / hashes,
+        BASE_INSTRUCTIONS + ITERATION_INSTRUCTIONS * min_taken,
+        BASE_INSTRUCTIONS + ITERATION_INSTRUCTIONS * max_taken);
+    for (int m = 0; m < modes; ++m) {
+        printf("Correlation of per-seed mean instructions and %s cost: %.3f\n", mode_names[m], summary[m].correlation);
+    }
+    printf("\nOutliers (mean or p99 cost more than %i%% above the median seed): %" PRIu64 " of %" PRIu64 " seeds\n",
+        outlier_percent, outliers, seeds);
+    if (outliers > 0) {
+        printf("%-64s %10s %10s %10s %10s %8s\n", "seed", "int mean", "int p99", "cmp mean", "cmp p99", "instr");
+        for (uint64_t i = 0; i < outliers && i < MAX_OUTLIERS_SHOWN; ++i) {
+            const seed_record* record = worst[i];
+            uint8_t seed[HASHWX_SEED_SIZE];
+            siphash_key keys[2];
+            make_seed(record->index, seed, keys);
+            for (int j = 0; j < HASHWX_SEED_SIZE; ++j) {
+                printf("%02x", seed[j]);
+            }
+            printf(" %10.1f %10" PRIu64 " %10.1f %10" PRIu64 " %8.1f\n",
+                record->mean[MODE_INTERPRETED], record->p99[MODE_INTERPRETED],
+                record->mean[MODE_COMPILED], record->p99[MODE_COMPILED], record->instructions);
+        }
+    }
+    for (int m = 0; m < modes; ++m) {
+        const mode_summary* ms = &summary[m];
+        printf("\nHistogram of per-seed mean cost, %s (%s):\n", mode_names[m], TIMER_UNIT);
+        seed_histogram(records, seeds, m, ms, bins, counts);
+        uint64_t max_count = 0;
+        for (int b = 0; b < bins; ++b) {
+            max_count = counts[b] > max_count ? counts[b] : max_count;
+        }
+        double width = (ms->max - ms->min) / bins;
+        for (int b = 0; b < bins; ++b) {
+            printf("%10.1f %10" PRIu64 " ", ms->min + b * width, counts[b]);
+            print_bar(counts[b], max_count);
+        }
+        printf("\nHistogram of the cost of all hashes, %s (%s):\n", mode_names[m], TIMER_UNIT);
+        int first = LOG_BUCKETS, last = 0;
+        max_count = 0;
+        for (int b = 0; b < LOG_BUCKETS; ++b) {
+            if (hash_buckets[m][b] > 0) {
+                first = b < first ? b : first;
+                last = b;
+                max_count = hash_buckets[m][b] > max_count ? hash_buckets[m][b] : max_count;
+            }
+        }
+        for (int b = first; b <= last; ++b) {
+            printf("%10" PRIu64 " %10" PRIu64 " ", log_bucket_min(b), hash_buckets[m][b]);
+            print_bar(hash_buckets[m][b], max_count);
+        }
+    }
+    printf("\nHistogram of executed instructions per hash:\n");
+    uint64_t max_count = 0;
+    for (int k = 0; k <= MAX_ITERATIONS; ++k) {
+        max_count = iterations[k] > max_count ? iterations[k] : max_count;
+    }
+    for (int k = min_taken; k <= max_taken; ++k) {
+        printf("%10i %10" PRIu64 " ", BASE_INSTRUCTIONS + ITERATION_INSTRUCTIONS * k, iterations[k]);
+        print_bar(iterations[k], max_count);
+    }
+}
+
+static void print_json(const seed_record* records, uint64_t seeds, int nonces, int modes,
+    const mode_summary* summary, uint64_t (*hash_buckets)[LOG_BUCKETS], const uint64_t* iterations,
+    int bins, uint64_t* counts, uint64_t outliers, const seed_record** worst, int outlier_percent) {
+    printf("{\n  \"unit\": \"%s\",\n  \"seeds\": %" PRIu64 ",\n  \"nonces\": %i,\n  \"modes\": {\n",
+        TIMER_UNIT, seeds, nonces);
+    for (int m = 0; m < modes; ++m) {
+        const mode_summary* ms = &summary[m];
+        printf("    \"%s\": {\n", mode_names[m]);
+        printf("      \"seed_mean\": { \"mean\": %.1f, \"cv\": %.5f, \"min\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f },\n",
+            ms->mean, ms->cv, ms->min, ms->p50, ms->p99, ms->max);
+        printf("      \"seed_p99\": { \"p50\": %.0f, \"max\": %.0f },\n", ms->tail_p50, ms->tail_max);
+        printf("      \"instruction_correlation\": %.4f,\n", ms->correlation);
+        seed_histogram(records, seeds, m, ms, bins, counts);
+        double width = (ms->max - ms->min) / bins;
+        printf("      \"seed_mean_histogram\": [");
+        for (int b = 0; b < bins; ++b) {
+            printf("%s[%.1f, %" PRIu64 "]", b > 0 ? ", " : "", ms->min + b * width, counts[b]);
+        }
+        printf("],\n      \"hash_histogram\": [");
+        bool first = true;
+        for (int b = 0; b < LOG_BUCKETS; ++b) {
+            if (hash_buckets[m][b] > 0) {
+                printf("%s[%" PRIu64 ", %" PRIu64 "]", first ? "" : ", ", log_bucket_min(b), hash_buckets[m][b]);
+                first = false;
+            }
+        }
+        printf("]\n    }%s\n", m + 1 < modes ? "," : "");
+    }
+    printf("  },\n  \"instruction_histogram\": [");
+    bool first = true;
+    for (int k = 0; k <= MAX_ITERATIONS; ++k) {
+        if (iterations[k] > 0) {
+            printf("%s[%i, %" PRIu64 "]", first ? "" : ", ", BASE_INSTRUCTIONS + ITERATION_INSTRUCTIONS * k, iterations[k]);
+            first = false;
+        }
+    }
+    printf("],\n  \"outlier_percent\": %i,\n  \"outlier_count\": %" PRIu64 ",\n  \"outliers\": [\n",
+        outlier_percent, outliers);
+    for (uint64_t i = 0; i < outliers && i < MAX_OUTLIERS_SHOWN; ++i) {
+        const seed_record* record = worst[i];
+        uint8_t seed[HASHWX_SEED_SIZE];
+        siphash_key keys[2];
+        make_seed(record->index, seed, keys);
+        printf("    { \"seed\": \"");
+        for (int j = 0; j < HASHWX_SEED_SIZE; ++j) {
+            printf("%02x", seed[j]);
+        }
+        printf("\", \"instructions\": %.1f", record->instructions);
+        for (int m = 0; m < modes; ++m) {
+            printf(", \"%s\": { \"mean\": %.1f, \"p99\": %" PRIu64 " }", mode_names[m], record->mean[m], record->p99[m]);
+        }
+        printf(" }%s\n", i + 1 < outliers && i + 1 < MAX_OUTLIERS_SHOWN ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+static double worst_ratio(const seed_record* record, const mode_summary* summary, int modes) {
+    double ratio = 0;
+    for (int m = 0; m < modes; ++m) {
+        double mean_ratio = record->mean[m] / summary[m].p50;
+        double tail_ratio = record->p99[m] / summary[m].tail_p50;
+        ratio = mean_ratio > ratio ? mean_ratio : ratio;
+        ratio = tail_ratio > ratio ? tail_ratio : ratio;
+    }
+    return ratio;
+}
+
+static const mode_summary* sort_summary;
+static int sort_modes;
+
+static int compare_outliers(const void* a, const void* b) {
+    double x = worst_ratio(*(const seed_record* const*)a, sort_summary, sort_modes);
+    double y = worst_ratio(*(const seed_record* const*)b, sort_summary, sort_modes);
+    return (x < y) - (x > y);
+}
+
+int main(int argc, char** argv) {
+    int seeds_option, nonces, threads, outlier_percent, bins;
+    bool json, interpret;
+    read_int_option("--seeds", argc, argv, &seeds_option, 1000);
+    read_int_option("--nonces", argc, argv, &nonces, 256);
+    read_int_option("--threads", argc, argv, &threads, 1);
+    read_int_option("--outlier", argc, argv, &outlier_percent, 20);
+    read_int_option("--bins", argc, argv, &bins, 20);
+    read_option("--json", argc, argv, &json);
+    read_option("--interpret", argc, argv, &interpret);
+#if !defined(HASHWX_THREADS)
+    if (threads > 1) {
+        printf("Error: Your compiler doesn't support C11 threads.\n");
+        return 1;
+    }
+#endif
+    uint64_t seeds = (uint64_t)seeds_option;
+    int modes = MODE_COUNT;
+    variance_job* jobs = calloc(threads, sizeof(variance_job));
+    seed_record* records = malloc(sizeof(seed_record) * seeds);
+    if (jobs == NULL || records == NULL) {
+        printf("Error: memory allocation failure\n");
+        return 1;
+    }
+    for (int thd = 0; thd < threads; ++thd) {
+        variance_job* job = &jobs[thd];
+        job->id = thd;
+        job->threads = threads;
+        job->seeds = seeds;
+        job->nonces = nonces;
+        job->records = records;
+        job->program_list = malloc(sizeof(hashwx_program_list));
+        job->samples[MODE_INTERPRETED] = malloc(sizeof(uint64_t) * nonces);
+        job->samples[MODE_COMPILED] = malloc(sizeof(uint64_t) * nonces);
+        if (job->program_list == NULL || job->samples[MODE_INTERPRETED] == NULL ||
+            job->samples[MODE_COMPILED] == NULL) {
+            printf("Error: memory allocation failure\n");
+            return 1;
+        }
+        job->ctx = NULL;
+#if HASHWX_COMPILER && !defined(HASHWX_COMPILER_WASM)
+        if (!interpret) {
+            job->ctx = hashwx_alloc(HASHWX_COMPILED);
+            if (job->ctx == NULL) {
+                printf("Error: memory allocation failure\n");
+                return 1;
+            }
+            if (job->ctx == HASHWX_NOTSUPP) {
+                job->ctx = NULL;
+            }
+        }
+#endif
+        if (job->ctx == NULL) {
+            modes = MODE_INTERPRETED + 1;
+        }
+    }
+    if (!json) {
+        printf("Seeds: %" PRIu64 ", nonces per seed: %i, threads: %i, modes: %s\n", seeds, nonces, threads,
+            modes == MODE_COUNT ? "interpreted, compiled" : "interpreted");
+    }
+    if (threads > 1) {
+#if defined(HASHWX_THREADS)
+        for (int thd = 0; thd < threads; ++thd) {
+            if (thrd_create(&jobs[thd].thread, &worker, &jobs[thd]) != thrd_success) {
+                printf("Error: thread_create failed\n");
+                return 1;
+            }
+        }
+        for (int thd = 0; thd < threads; ++thd) {
+            thrd_join(jobs[thd].thread, NULL);
+        }
+#endif
+    }
+    else {
+        worker(jobs);
+    }
+    /* merge the counters of the threads into the first job */
+    for (int thd = 0; thd < threads; ++thd) {
+        variance_job* job = &jobs[thd];
+        if (job->mismatch) {
+            printf("Error: compiled hash mismatch\n");
+            return 1;
+        }
+        if (thd > 0) {
+            for (int m = 0; m < MODE_COUNT; ++m) {
+                for (int b = 0; b < LOG_BUCKETS; ++b) {
+                    jobs[0].hash_buckets[m][b] += job->hash_buckets[m][b];
+                }
+            }
+            for (int k = 0; k <= MAX_ITERATIONS; ++k) {
+                jobs[0].iterations[k] += job->iterations[k];
+            }
+        }
+    }
+    mode_summary summary[MODE_COUNT];
+    double* values = malloc(sizeof(double) * seeds);
+    const seed_record** worst = malloc(sizeof(seed_record*) * seeds);
+    uint64_t* counts = malloc(sizeof(uint64_t) * bins);
+    if (values == NULL || worst == NULL || counts == NULL) {
+        printf("Error: memory allocation failure\n");
+        return 1;
+    }
+    for (int m = 0; m < modes; ++m) {
+        summarize(records, seeds, m, values, &summary[m]);
+    }
+    uint64_t outliers = 0;
+    double limit = 1 + outlier_percent / 100.0;
+    for (uint64_t s = 0; s < seeds; ++s) {
+        seed_record* record = &records[s];
+        for (int run = 0; run < 2 && worst_ratio(record, summary, modes) > limit; ++run) {
+            seed_record again;
+            measure_seed(&jobs[0], s, &again, false);
+            for (int m = 0; m < modes; ++m) {
+                record->mean[m] = again.mean[m] < record->mean[m] ? again.mean[m] : record->mean[m];
+                record->p99[m] = again.p99[m] < record->p99[m] ? again.p99[m] : record->p99[m];
+            }
+        }
+        if (worst_ratio(record, summary, modes) > limit) {
+            worst[outliers++] = record;
+        }
+    }
+    /* the summary includes the repeated measurements */
+    for (int m = 0; m < modes; ++m) {
+        summarize(records, seeds, m, values, &summary[m]);
+    }
+    sort_summary = summary;
+    sort_modes = modes;
+    qsort(worst, outliers, sizeof(seed_record*), &compare_outliers);
+    if (json) {
+        print_json(records, seeds, nonces, modes, summary, jobs[0].hash_buckets, jobs[0].iterations,
+            bins, counts, outliers, worst, outlier_percent);
+    }
+    else {
+        print_text(records, seeds, nonces, modes, summary, jobs[0].hash_buckets, jobs[0].iterations,
+            bins, counts, outliers, worst, outlier_percent);
+    }
+    for (int thd = 0; thd < threads; ++thd) {
+        hashwx_free(jobs[thd].ctx);
+        free(jobs[thd].program_list);
+        free(jobs[thd].samples[MODE_INTERPRETED]);
+        free(jobs[thd].samples[MODE_COMPILED]);
+    }
+    free(counts);
+    free(worst);
+    free(values);
+    free(records);
+    free(jobs);
+    return 0;
+}
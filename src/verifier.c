@@ -0,0 +1,229 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include <hashwx.h>
+#include "worker_pool.h"
+
+/* Maximum number of proofs with the same seed processed as one work item */
+#define MAX_ITEM_PROOFS 256
+/* Number of proofs hashed by one hashwx_exec_array call */
+#define VERIFY_BATCH 16
+
+typedef struct verifier_item {
+    size_t begin;
+    size_t end;
+} verifier_item;
+
+typedef struct verifier_worker {
+    hashwx_ctx* ctx;
+    bool has_seed;
+    uint8_t seed[HASHWX_SEED_SIZE];
+} verifier_worker;
+
+struct hashwx_verifier {
+    hashwx_worker_pool* pool;
+    verifier_worker* workers;
+    hashwx_mutex call_lock;
+    hashwx_mutex item_lock;
+    /* state of the current hashwx_verify_many call */
+    const hashwx_proof** sorted;
+    uint8_t* valid;
+    verifier_item* items;
+    size_t num_items;
+    size_t next_item;
+    /* scratch buffer for the above arrays */
+    void* scratch;
+    size_t scratch_size;
+};
+
+static int compare_seeds(const void* a, const void* b) {
+    const hashwx_proof* pa = *(const hashwx_proof* const*)a;
+    const hashwx_proof* pb = *(const hashwx_proof* const*)b;
+    int cmp = memcmp(pa->seed, pb->seed, HASHWX_SEED_SIZE);
+    if (cmp != 0) {
+        return cmp;
+    }
+    /* keep the original order within a seed group */
+    return (pa > pb) - (pa < pb);
+}
+
+static void verify_worker(void* job, int worker_id) {
+    hashwx_verifier* verifier = (hashwx_verifier*)job;
+    verifier_worker* worker = &verifier->workers[worker_id];
+    const hashwx_proof** sorted = verifier->sorted;
+    uint8_t* valid = verifier->valid;
+    for (;;) {
+        hashwx_mutex_lock(&verifier->item_lock);
+        size_t index = verifier->next_item++;
+        hashwx_mutex_unlock(&verifier->item_lock);
+        if (index >= verifier->num_items) {
+            break;
+        }
+        verifier_item item = verifier->items[index];
+        const uint8_t* seed = sorted[item.begin]->seed;
+        bool is_hot = worker->has_seed &&
+            memcmp(worker->seed, seed, HASHWX_SEED_SIZE) == 0;
+        if (!is_hot && item.end - item.begin == 1) {
+            /* a lone proof is cheaper to verify without making a function */
+            const hashwx_proof* proof = sorted[item.begin];
+            valid[item.begin] = hashwx_verify(seed, proof->nonce) < proof->target;
+            continue;
+        }
+        if (!is_hot) {
+            hashwx_make(worker->ctx, seed);
+            memcpy(worker->seed, seed, HASHWX_SEED_SIZE);
+            worker->has_seed = true;
+        }
+        /* hash in small batches, so interpreted instances can use SIMD */
+        for (size_t i = item.begin; i < item.end; i += VERIFY_BATCH) {
+            uint64_t nonces[VERIFY_BATCH], hashes[VERIFY_BATCH];
+            size_t batch = item.end - i < VERIFY_BATCH ? item.end - i : VERIFY_BATCH;
+            for (size_t j = 0; j < batch; ++j) {
+                nonces[j] = sorted[i + j]->nonce;
+            }
+            hashwx_exec_array(worker->ctx, nonces, batch, hashes);
+            for (size_t j = 0; j < batch; ++j) {
+                valid[i + j] = hashes[j] < sorted[i + j]->target;
+            }
+        }
+    }
+}
+
+static bool reserve_scratch(hashwx_verifier* verifier, size_t count) {
+    const size_t entry_size = sizeof(const hashwx_proof*) + sizeof(verifier_item) + 1;
+    if (count > SIZE_MAX / entry_size) {
+        return false;
+    }
+    size_t size = count * entry_size;
+    if (size > verifier->scratch_size) {
+        void* scratch = malloc(size);
+        if (scratch == NULL) {
+            return false;
+        }
+        free(verifier->scratch);
+        verifier->scratch = scratch;
+        verifier->scratch_size = size;
+    }
+    uint8_t* p = verifier->scratch;
+    verifier->sorted = (const hashwx_proof**)p;
+    p += count * sizeof(const hashwx_proof*);
+    verifier->items = (verifier_item*)p;
+    p += count * sizeof(verifier_item);
+    verifier->valid = p;
+    return true;
+}
+
+hashwx_verifier* hashwx_verifier_alloc(hashwx_type type, int threads) {
+    hashwx_verifier* verifier = malloc(sizeof(hashwx_verifier));
+    if (verifier == NULL) {
+        return NULL;
+    }
+    verifier->workers = NULL;
+    verifier->scratch = NULL;
+    verifier->scratch_size = 0;
+    verifier->pool = hashwx_pool_alloc(threads);
+    if (verifier->pool == NULL) {
+        goto failure;
+    }
+    int workers = hashwx_pool_size(verifier->pool);
+    verifier->workers = calloc(workers, sizeof(verifier_worker));
+    if (verifier->workers == NULL) {
+        goto failure;
+    }
+    for (int i = 0; i < workers; ++i) {
+        hashwx_ctx* ctx = hashwx_alloc(type);
+        if (ctx == NULL || ctx == HASHWX_NOTSUPP) {
+            goto failure;
+        }
+        verifier->workers[i].ctx = ctx;
+    }
+    if (!hashwx_mutex_init(&verifier->call_lock)) {
+        goto failure;
+    }
+    if (!hashwx_mutex_init(&verifier->item_lock)) {
+        hashwx_mutex_destroy(&verifier->call_lock);
+        goto failure;
+    }
+    return verifier;
+failure:
+    if (verifier->workers != NULL) {
+        for (int i = 0; i < hashwx_pool_size(verifier->pool); ++i) {
+            hashwx_free(verifier->workers[i].ctx);
+        }
+        free(verifier->workers);
+    }
+    hashwx_pool_free(verifier->pool);
+    free(verifier);
+    return NULL;
+}
+
+size_t hashwx_verify_many(hashwx_verifier* verifier, const hashwx_proof* proofs,
+    size_t count, uint8_t* results) {
+    assert(verifier != NULL);
+    assert(proofs != NULL || count == 0);
+    assert(results != NULL || count == 0);
+    size_t num_valid = 0;
+    if (count == 0) {
+        return 0;
+    }
+    memset(results, 0, (count + 7) / 8);
+    hashwx_mutex_lock(&verifier->call_lock);
+    if (!reserve_scratch(verifier, count)) {
+        /* out of memory: verify the proofs one by one */
+        for (size_t i = 0; i < count; ++i) {
+            if (hashwx_verify(proofs[i].seed, proofs[i].nonce) < proofs[i].target) {
+                results[i / 8] |= 1 << (i % 8);
+                num_valid++;
+            }
+        }
+        hashwx_mutex_unlock(&verifier->call_lock);
+        return num_valid;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        verifier->sorted[i] = &proofs[i];
+    }
+    qsort(verifier->sorted, count, sizeof(const hashwx_proof*), &compare_seeds);
+    verifier->num_items = 0;
+    verifier->next_item = 0;
+    for (size_t begin = 0; begin < count;) {
+        size_t end = begin + 1;
+        while (end < count && end - begin < MAX_ITEM_PROOFS &&
+            memcmp(verifier->sorted[begin]->seed, verifier->sorted[end]->seed, HASHWX_SEED_SIZE) == 0) {
+            end++;
+        }
+        verifier_item* item = &verifier->items[verifier->num_items++];
+        item->begin = begin;
+        item->end = end;
+        begin = end;
+    }
+    hashwx_pool_run(verifier->pool, &verify_worker, verifier);
+    for (size_t i = 0; i < count; ++i) {
+        if (verifier->valid[i]) {
+            size_t index = (size_t)(verifier->sorted[i] - proofs);
+            results[index / 8] |= 1 << (index % 8);
+            num_valid++;
+        }
+    }
+    hashwx_mutex_unlock(&verifier->call_lock);
+    return num_valid;
+}
+
+void hashwx_verifier_free(hashwx_verifier* verifier) {
+    if (verifier == NULL) {
+        return;
+    }
+    for (int i = 0; i < hashwx_pool_size(verifier->pool); ++i) {
+        hashwx_free(verifier->workers[i].ctx);
+    }
+    free(verifier->workers);
+    hashwx_pool_free(verifier->pool);
+    hashwx_mutex_destroy(&verifier->item_lock);
+    hashwx_mutex_destroy(&verifier->call_lock);
+    free(verifier->scratch);
+    free(verifier);
+}
@@ -1,6 +1,10 @@
 /* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
 /* See LICENSE for licensing information */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "virtual_memory.h"
 
 #ifndef __wasm__
@@ -8,10 +12,15 @@
 #if defined(HASHWX_WIN)
 #include <windows.h>
 #else
-#define _GNU_SOURCE
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(MFD_CLOEXEC)
+#define HAVE_MEMFD
+#endif
 #ifndef MAP_ANONYMOUS
 #define MAP_ANONYMOUS MAP_ANON
 #endif
@@ -70,4 +79,98 @@ void hashwx_vm_free(void* ptr, size_t bytes) {
 #endif
 }
 
+/*
+    Maps the same memory twice: the returned view is read-write and
+    the executable view is read-execute. Code written through the first view
+    can be executed through the second one without any mprotect calls.
+*/
+void* hashwx_vm_alloc_dual(size_t bytes, void** exec_view) {
+#ifdef HAVE_MEMFD
+    int fd = memfd_create("hashwx", MFD_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    void* mem = MAP_FAILED;
+    if (ftruncate(fd, (off_t)bytes) == 0) {
+        mem = mmap(NULL, bytes, PAGE_READWRITE, MAP_SHARED, fd, 0);
+    }
+    if (mem != MAP_FAILED) {
+        void* exec = mmap(NULL, bytes, PAGE_EXECUTE_READ, MAP_SHARED, fd, 0);
+        if (exec != MAP_FAILED) {
+            *exec_view = exec;
+        }
+        else {
+            munmap(mem, bytes);
+            mem = MAP_FAILED;
+        }
+    }
+    close(fd);
+    return mem != MAP_FAILED ? mem : NULL;
+#else
+    (void)bytes;
+    (void)exec_view;
+    return NULL;
+#endif
+}
+
+void hashwx_vm_free_dual(void* ptr, void* exec_view, size_t bytes) {
+#ifdef HAVE_MEMFD
+    munmap(exec_view, bytes);
+    munmap(ptr, bytes);
+#else
+    (void)ptr;
+    (void)exec_view;
+    (void)bytes;
+#endif
+}
+
+/*
+    Maps a whole file read-only. Empty files can't be mapped.
+*/
+const void* hashwx_vm_map_file(const char* path, size_t* size) {
+#ifdef HASHWX_WIN
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    const void* view = NULL;
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 &&
+        (uint64_t)file_size.QuadPart <= SIZE_MAX) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            /* the view keeps the mapping alive */
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = (size_t)file_size.QuadPart;
+    }
+    CloseHandle(file);
+    return view;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    void* mem = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX) {
+        mem = mmap(NULL, (size_t)st.st_size, PAGE_READONLY, MAP_PRIVATE, fd, 0);
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return mem != MAP_FAILED ? mem : NULL;
+#endif
+}
+
+void hashwx_vm_unmap_file(const void* ptr, size_t bytes) {
+#ifdef HASHWX_WIN
+    (void)bytes;
+    UnmapViewOfFile(ptr);
+#else
+    munmap((void*)ptr, bytes);
+#endif
+}
+
 #endif /* __wasm__ */
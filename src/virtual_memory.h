@@ -12,5 +12,9 @@ HASHWX_PRIVATE void* hashwx_vm_alloc(size_t size);
 HASHWX_PRIVATE void hashwx_vm_rw(void* ptr, size_t size);
 HASHWX_PRIVATE void hashwx_vm_rx(void* ptr, size_t size);
 HASHWX_PRIVATE void hashwx_vm_free(void* ptr, size_t size);
+HASHWX_PRIVATE void* hashwx_vm_alloc_dual(size_t size, void** exec_view);
+HASHWX_PRIVATE void hashwx_vm_free_dual(void* ptr, void* exec_view, size_t size);
+HASHWX_PRIVATE const void* hashwx_vm_map_file(const char* path, size_t* size);
+HASHWX_PRIVATE void hashwx_vm_unmap_file(const void* ptr, size_t size);
 
 #endif
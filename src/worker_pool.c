@@ -0,0 +1,181 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "worker_pool.h"
+
+#ifdef HASHWX_THREADS
+
+typedef struct worker_thread {
+    hashwx_worker_pool* pool;
+    int id;
+    thrd_t thread;
+} worker_thread;
+
+struct hashwx_worker_pool {
+    int size;
+    mtx_t lock;
+    cnd_t start;
+    cnd_t done;
+    hashwx_worker_func* func;
+    void* job;
+    uint64_t generation;
+    int running;
+    bool quit;
+    worker_thread* threads;
+};
+
+static int worker_main(void* arg) {
+    worker_thread* thread = (worker_thread*)arg;
+    hashwx_worker_pool* pool = thread->pool;
+    uint64_t generation = 0;
+    mtx_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit && pool->generation == generation) {
+            cnd_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        generation = pool->generation;
+        hashwx_worker_func* func = pool->func;
+        void* job = pool->job;
+        mtx_unlock(&pool->lock);
+        func(job, thread->id);
+        mtx_lock(&pool->lock);
+        if (--pool->running == 0) {
+            cnd_signal(&pool->done);
+        }
+    }
+    mtx_unlock(&pool->lock);
+    return 0;
+}
+
+hashwx_worker_pool* hashwx_pool_alloc(int workers) {
+    hashwx_worker_pool* pool = malloc(sizeof(hashwx_worker_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (workers < 1) {
+        workers = 1;
+    }
+    pool->size = 1;
+    pool->func = NULL;
+    pool->job = NULL;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->quit = false;
+    pool->threads = NULL;
+    if (workers == 1) {
+        return pool;
+    }
+    if (mtx_init(&pool->lock, mtx_plain) != thrd_success) {
+        goto failure;
+    }
+    if (cnd_init(&pool->start) != thrd_success) {
+        goto failure_lock;
+    }
+    if (cnd_init(&pool->done) != thrd_success) {
+        goto failure_start;
+    }
+    pool->threads = malloc(sizeof(worker_thread) * (workers - 1));
+    if (pool->threads == NULL) {
+        goto failure_done;
+    }
+    for (int i = 1; i < workers; ++i) {
+        worker_thread* thread = &pool->threads[i - 1];
+        thread->pool = pool;
+        thread->id = i;
+        if (thrd_create(&thread->thread, &worker_main, thread) != thrd_success) {
+            /* continue with the threads that were created */
+            break;
+        }
+        pool->size++;
+    }
+    return pool;
+failure_done:
+    cnd_destroy(&pool->done);
+failure_start:
+    cnd_destroy(&pool->start);
+failure_lock:
+    mtx_destroy(&pool->lock);
+failure:
+    free(pool);
+    return NULL;
+}
+
+int hashwx_pool_size(const hashwx_worker_pool* pool) {
+    return pool->size;
+}
+
+void hashwx_pool_run(hashwx_worker_pool* pool, hashwx_worker_func* func, void* job) {
+    if (pool->threads == NULL) {
+        func(job, 0);
+        return;
+    }
+    mtx_lock(&pool->lock);
+    pool->func = func;
+    pool->job = job;
+    pool->running = pool->size - 1;
+    pool->generation++;
+    cnd_broadcast(&pool->start);
+    mtx_unlock(&pool->lock);
+    func(job, 0);
+    mtx_lock(&pool->lock);
+    while (pool->running != 0) {
+        cnd_wait(&pool->done, &pool->lock);
+    }
+    mtx_unlock(&pool->lock);
+}
+
+void hashwx_pool_free(hashwx_worker_pool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    if (pool->threads != NULL) {
+        mtx_lock(&pool->lock);
+        pool->quit = true;
+        cnd_broadcast(&pool->start);
+        mtx_unlock(&pool->lock);
+        for (int i = 1; i < pool->size; ++i) {
+            thrd_join(pool->threads[i - 1].thread, NULL);
+        }
+        free(pool->threads);
+        cnd_destroy(&pool->done);
+        cnd_destroy(&pool->start);
+        mtx_destroy(&pool->lock);
+    }
+    free(pool);
+}
+
+#else
+
+struct hashwx_worker_pool {
+    int size;
+};
+
+hashwx_worker_pool* hashwx_pool_alloc(int workers) {
+    (void)workers;
+    hashwx_worker_pool* pool = malloc(sizeof(hashwx_worker_pool));
+    if (pool != NULL) {
+        pool->size = 1;
+    }
+    return pool;
+}
+
+int hashwx_pool_size(const hashwx_worker_pool* pool) {
+    return pool->size;
+}
+
+void hashwx_pool_run(hashwx_worker_pool* pool, hashwx_worker_func* func, void* job) {
+    (void)pool;
+    func(job, 0);
+}
+
+void hashwx_pool_free(hashwx_worker_pool* pool) {
+    free(pool);
+}
+
+#endif
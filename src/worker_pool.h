@@ -0,0 +1,109 @@
+/* Copyright (c) 2020-2026 tevador <tevador@gmail.com> */
+/* See LICENSE for licensing information */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+#include <hashwx.h>
+
+#ifdef HASHWX_THREADS
+#include <threads.h>
+typedef mtx_t hashwx_mutex;
+typedef cnd_t hashwx_cond;
+#else
+typedef int hashwx_mutex;
+typedef int hashwx_cond;
+#endif
+
+/*
+    A fixed set of worker threads that execute the same job function.
+    Worker 0 is always the thread that calls hashwx_pool_run, so a pool
+    of size 1 doesn't create any threads. Without C11 threads, the pool
+    size is always 1.
+*/
+typedef struct hashwx_worker_pool hashwx_worker_pool;
+
+typedef void hashwx_worker_func(void* job, int worker_id);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HASHWX_PRIVATE hashwx_worker_pool* hashwx_pool_alloc(int workers);
+HASHWX_PRIVATE int hashwx_pool_size(const hashwx_worker_pool* pool);
+HASHWX_PRIVATE void hashwx_pool_run(hashwx_worker_pool* pool, hashwx_worker_func* func, void* job);
+HASHWX_PRIVATE void hashwx_pool_free(hashwx_worker_pool* pool);
+
+static inline bool hashwx_mutex_init(hashwx_mutex* mutex) {
+#ifdef HASHWX_THREADS
+    return mtx_init(mutex, mtx_plain) == thrd_success;
+#else
+    *mutex = 0;
+    return true;
+#endif
+}
+
+static inline void hashwx_mutex_lock(hashwx_mutex* mutex) {
+#ifdef HASHWX_THREADS
+    mtx_lock(mutex);
+#else
+    (void)mutex;
+#endif
+}
+
+static inline void hashwx_mutex_unlock(hashwx_mutex* mutex) {
+#ifdef HASHWX_THREADS
+    mtx_unlock(mutex);
+#else
+    (void)mutex;
+#endif
+}
+
+static inline void hashwx_mutex_destroy(hashwx_mutex* mutex) {
+#ifdef HASHWX_THREADS
+    mtx_destroy(mutex);
+#else
+    (void)mutex;
+#endif
+}
+
+static inline bool hashwx_cond_init(hashwx_cond* cond) {
+#ifdef HASHWX_THREADS
+    return cnd_init(cond) == thrd_success;
+#else
+    *cond = 0;
+    return true;
+#endif
+}
+
+static inline void hashwx_cond_wait(hashwx_cond* cond, hashwx_mutex* mutex) {
+#ifdef HASHWX_THREADS
+    cnd_wait(cond, mutex);
+#else
+    (void)cond;
+    (void)mutex;
+#endif
+}
+
+static inline void hashwx_cond_broadcast(hashwx_cond* cond) {
+#ifdef HASHWX_THREADS
+    cnd_broadcast(cond);
+#else
+    (void)cond;
+#endif
+}
+
+static inline void hashwx_cond_destroy(hashwx_cond* cond) {
+#ifdef HASHWX_THREADS
+    cnd_destroy(cond);
+#else
+    (void)cond;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif